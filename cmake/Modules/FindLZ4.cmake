@@ -0,0 +1,43 @@
+# This file is part of the PARIS reconstruction program.
+#
+# Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+#
+# PARIS is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# PARIS is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+
+# - Find LZ4
+# Find the lz4 include directory and library
+#
+# Use this module by invoking FIND_PACKAGE with the form:
+#
+#   FIND_PACKAGE(LZ4 [REQUIRED])
+#
+# Results are reported in the following variables:
+#
+#   LZ4_FOUND
+#   LZ4_INCLUDE_DIR
+#   LZ4_LIBRARY
+
+IF(LZ4_INCLUDE_DIR)
+    # LZ4 already found, don't look again
+    SET(LZ4_FIND_QUIETLY TRUE)
+ENDIF(LZ4_INCLUDE_DIR)
+
+FIND_PATH(LZ4_INCLUDE_DIR lz4.h)
+FIND_LIBRARY(LZ4_LIBRARY lz4)
+
+# handle REQUIRED and QUIET parameters
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 DEFAULT_MSG LZ4_INCLUDE_DIR LZ4_LIBRARY)
+
+MARK_AS_ADVANCED(LZ4_INCLUDE_DIR LZ4_LIBRARY)
@@ -22,6 +22,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
@@ -34,14 +35,15 @@
 
 namespace paris
 {
-    auto backproject(const backend::projection_device_type& p,
+    auto backproject(const std::vector<backend::projection_device_type>& p,
                      backend::volume_device_type& v,
                      std::uint32_t v_offset,
                      const detector_geometry& det_geo,
                      const volume_geometry& vol_geo,
                      bool enable_angles,
                      bool enable_roi,
-                     const region_of_interest& roi)
+                     const region_of_interest& roi,
+                     bool skip_invisible)
         noexcept(true && noexcept(backend::backproject))
         -> void
     {
@@ -49,22 +51,31 @@ namespace paris
         static const auto delta_s = det_geo.delta_s * det_geo.l_px_row;
         static const auto delta_t = det_geo.delta_t * det_geo.l_px_col;
 
-        // get angular position of the current projection
-        auto phi = 0.f;
-        if(enable_angles)
-            phi = p.phi;
-        else
-            phi = static_cast<float>(p.idx) * det_geo.delta_phi;
+        auto sin = std::vector<float>{};
+        auto cos = std::vector<float>{};
+        sin.reserve(p.size());
+        cos.reserve(p.size());
 
-        // transform to radians
-        phi *= static_cast<float>(M_PI) / 180.f;
+        for(auto&& proj : p)
+        {
+            // get angular position of the current projection
+            auto phi = 0.f;
+            if(enable_angles)
+                phi = proj.phi;
+            else
+                phi = static_cast<float>(proj.idx) * det_geo.delta_phi;
 
-        auto sin = std::sin(phi);
-        auto cos = std::cos(phi);
+            // transform to radians
+            phi *= static_cast<float>(M_PI) / 180.f;
 
-        if(p.idx % 10u == 0u)
-            BOOST_LOG_TRIVIAL(info) << "Processing projection #" << p.idx;
+            sin.push_back(std::sin(phi));
+            cos.push_back(std::cos(phi));
 
-        backend::backproject(p, v, v_offset, det_geo, vol_geo, enable_roi, roi, sin, cos, delta_s, delta_t);
+            if(proj.idx % 10u == 0u)
+                BOOST_LOG_TRIVIAL(info) << "Processing projection #" << proj.idx;
+        }
+
+        backend::backproject(p, v, v_offset, det_geo, vol_geo, enable_roi, roi, sin, cos, delta_s, delta_t,
+                             skip_invisible);
     }
 }
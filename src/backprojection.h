@@ -24,6 +24,7 @@
 #define PARIS_BACKPROJECTION_H_
 
 #include <cstdint>
+#include <vector>
 
 #include "backend.h"
 #include "geometry.h"
@@ -33,14 +34,15 @@
 
 namespace paris
 {
-    auto backproject(const backend::projection_device_type& p,
+    auto backproject(const std::vector<backend::projection_device_type>& p,
                      backend::volume_device_type& v,
                      std::uint32_t v_offset,
                      const detector_geometry& det_geo,
                      const volume_geometry& vol_geo,
                      bool enable_angles,
                      bool enable_roi,
-                     const region_of_interest& roi)
+                     const region_of_interest& roi,
+                     bool skip_invisible)
         noexcept(true && noexcept(backend::backproject))
         -> void;
 }
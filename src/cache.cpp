@@ -0,0 +1,230 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "cache.h"
+#include "filesystem.h"
+#include "geometry.h"
+
+namespace paris
+{
+    namespace
+    {
+        constexpr auto cache_id = std::uint32_t{0xCAC4EFDD};
+
+        // bump this whenever the layout of the cached data changes
+        constexpr auto cache_version = std::uint32_t{1};
+
+        // 64 bit FNV-1a
+        class hasher
+        {
+            public:
+                template <class T>
+                auto add(const T& t) noexcept -> void
+                {
+                    auto bytes = reinterpret_cast<const unsigned char*>(&t);
+                    for(auto i = 0u; i < sizeof(T); ++i)
+                    {
+                        hash_ ^= bytes[i];
+                        hash_ *= 0x100000001B3u;
+                    }
+                }
+
+                auto add(const std::string& s) noexcept -> void
+                {
+                    for(auto&& c : s)
+                        add(c);
+                    add(s.size());
+                }
+
+                auto get() const noexcept -> std::uint64_t { return hash_; }
+
+            private:
+                std::uint64_t hash_ = 0xCBF29CE484222325u;
+        };
+    }
+
+    auto make_cache_directory(const std::string& root, const detector_geometry& det_geo, std::uint32_t filter_size)
+        -> std::string
+    {
+        // hash the members one by one so padding bytes don't influence the result
+        auto h = hasher{};
+        h.add(cache_version);
+        h.add(det_geo.n_row);
+        h.add(det_geo.n_col);
+        h.add(det_geo.l_px_row);
+        h.add(det_geo.l_px_col);
+        h.add(det_geo.delta_s);
+        h.add(det_geo.delta_t);
+        h.add(det_geo.d_so);
+        h.add(det_geo.d_od);
+        h.add(filter_size);
+
+        auto&& name = std::ostringstream{};
+        name << std::hex << std::setw(16) << std::setfill('0') << h.get();
+
+        auto path = root + "/" + name.str();
+        if(!create_directory(path))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Could not create cache directory " << path << ", caching disabled";
+            return std::string{};
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Using cache directory " << path;
+        return path;
+    }
+
+    auto make_input_key(const std::string& input_path, const detector_geometry& det_geo, std::uint16_t quality,
+                        bool enable_angles, const std::string& angle_path) -> std::uint64_t
+    {
+        auto h = hasher{};
+        h.add(cache_version);
+        h.add(det_geo.n_row);
+        h.add(det_geo.n_col);
+        h.add(det_geo.l_px_row);
+        h.add(det_geo.l_px_col);
+        h.add(det_geo.delta_s);
+        h.add(det_geo.delta_t);
+        h.add(det_geo.d_so);
+        h.add(det_geo.d_od);
+        h.add(quality);
+
+        auto add_file = [&h](const std::string& path)
+        {
+            auto size_ec = boost::system::error_code{};
+            auto time_ec = boost::system::error_code{};
+            const auto size = boost::filesystem::file_size(path, size_ec);
+            const auto mtime = boost::filesystem::last_write_time(path, time_ec);
+            h.add(path);
+            h.add(static_cast<std::uint64_t>(size_ec ? 0u : size));
+            h.add(static_cast<std::int64_t>(time_ec ? 0 : mtime));
+        };
+
+        h.add(enable_angles);
+        if(enable_angles)
+            add_file(angle_path);
+
+        if(is_regular_file(input_path))
+            add_file(input_path);
+        else
+        {
+            for(auto&& path : read_directory(input_path))
+                add_file(path);
+        }
+
+        return h.get();
+    }
+
+    auto filtered_cache_path(const std::string& input_path) -> std::string
+    {
+        auto path = input_path;
+        while(path.size() > 1u && path.back() == '/')
+            path.pop_back();
+        return path + ".filtered";
+    }
+
+    auto read_cache_file(const std::string& path, float* dst, std::size_t n) -> bool
+    {
+        auto&& file = std::ifstream{path.c_str(), std::ios::in | std::ios::binary};
+        if(!file)
+            return false;
+
+        auto id = std::uint32_t{};
+        auto version = std::uint32_t{};
+        auto size = std::uint64_t{};
+        file.read(reinterpret_cast<char*>(&id), sizeof(id));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+        if(!file || id != cache_id || version != cache_version || size != n)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Ignoring invalid cache file " << path;
+            return false;
+        }
+
+        file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n * sizeof(float)));
+        if(!file)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Ignoring truncated cache file " << path;
+            return false;
+        }
+
+        BOOST_LOG_TRIVIAL(debug) << "Loaded " << path << " from cache";
+        return true;
+    }
+
+    auto temporary_cache_path(const std::string& path) -> std::string
+    {
+        return path + ".tmp" + std::to_string(getpid());
+    }
+
+    auto publish_cache_file(const std::string& tmp_path, const std::string& path) -> void
+    {
+        auto ec = boost::system::error_code{};
+        boost::filesystem::rename(tmp_path, path, ec);
+        if(ec)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Could not write cache file " << path << ": " << ec.message();
+            boost::filesystem::remove(tmp_path, ec);
+        }
+    }
+
+    auto write_cache_file(const std::string& path, const float* src, std::size_t n) -> void
+    {
+        // write to a temporary file first so concurrent runs never see a partial file
+        auto tmp_path = temporary_cache_path(path);
+
+        {
+            auto&& file = std::ofstream{tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc};
+
+            const auto size = static_cast<std::uint64_t>(n);
+            file.write(reinterpret_cast<const char*>(&cache_id), sizeof(cache_id));
+            file.write(reinterpret_cast<const char*>(&cache_version), sizeof(cache_version));
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(n * sizeof(float)));
+
+            if(!file)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Could not write cache file " << path;
+                file.close();
+
+                auto ec = boost::system::error_code{};
+                boost::filesystem::remove(tmp_path, ec);
+                return;
+            }
+        }
+
+        publish_cache_file(tmp_path, path);
+    }
+}
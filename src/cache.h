@@ -0,0 +1,80 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_CACHE_H_
+#define PARIS_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "geometry.h"
+
+namespace paris
+{
+    /**
+     * Precomputed data (FFT plans, filter kernel, weight map) is stored in a subdirectory of the cache directory
+     * whose name is derived from the detector geometry and the FFT length. Returns the path of this subdirectory
+     * or an empty string if it could not be created.
+     */
+    auto make_cache_directory(const std::string& root, const detector_geometry& det_geo, std::uint32_t filter_size)
+        -> std::string;
+
+    /**
+     * Path of a file inside the cache directory, empty if caching is disabled.
+     */
+    inline auto cache_file(const std::string& cache_dir, const std::string& name) -> std::string
+    {
+        return cache_dir.empty() ? std::string{} : cache_dir + "/" + name;
+    }
+
+    /**
+     * Reads n floats from a cache file. Returns false if the file is missing or does not contain exactly n values.
+     */
+    auto read_cache_file(const std::string& path, float* dst, std::size_t n) -> bool;
+
+    /**
+     * Identifies the preprocessed projections of an input: detector geometry, quality, angle file and the name, size
+     * and modification time of every input file. Any change leads to a different key.
+     */
+    auto make_input_key(const std::string& input_path, const detector_geometry& det_geo, std::uint16_t quality,
+                        bool enable_angles, const std::string& angle_path) -> std::uint64_t;
+
+    /**
+     * The filtered projection cache lives next to the input directory or container.
+     */
+    auto filtered_cache_path(const std::string& input_path) -> std::string;
+
+    /**
+     * Cache files are written to a temporary file next to their final path and renamed once complete, so concurrent
+     * runs never see a partial file. publish_cache_file() removes the temporary file if the rename fails.
+     */
+    auto temporary_cache_path(const std::string& path) -> std::string;
+    auto publish_cache_file(const std::string& tmp_path, const std::string& path) -> void;
+
+    /**
+     * Writes n floats to a cache file. Failures are logged and otherwise ignored - the cache is an optimization.
+     */
+    auto write_cache_file(const std::string& path, const float* src, std::size_t n) -> void;
+}
+
+#endif /* PARIS_CACHE_H_ */
@@ -0,0 +1,213 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#ifdef PARIS_ENABLE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef PARIS_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compression.h"
+
+namespace paris
+{
+    namespace compression
+    {
+        namespace
+        {
+            // fast levels, the writers must keep up with the reconstruction
+            constexpr auto zstd_level = 3;
+
+#if !defined(PARIS_ENABLE_LZ4) || !defined(PARIS_ENABLE_ZSTD)
+            auto unavailable(codec c) -> std::runtime_error
+            {
+                return std::runtime_error{"PARIS was built without " + to_string(c) + " support"};
+            }
+#endif
+
+#ifdef PARIS_ENABLE_LZ4
+            auto lz4_size(std::size_t n) -> int
+            {
+                if(n > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+                    throw std::runtime_error{"compression::compress(): lz4 block too large"};
+                return static_cast<int>(n);
+            }
+#endif
+        }
+
+        auto available(codec c) noexcept -> bool
+        {
+            switch(c)
+            {
+                case codec::none:
+                    return true;
+
+                case codec::lz4:
+#ifdef PARIS_ENABLE_LZ4
+                    return true;
+#else
+                    return false;
+#endif
+
+                case codec::zstd:
+#ifdef PARIS_ENABLE_ZSTD
+                    return true;
+#else
+                    return false;
+#endif
+            }
+            return false;
+        }
+
+        auto from_string(const std::string& name) -> codec
+        {
+            if(name == "none")
+                return codec::none;
+            if(name == "lz4")
+                return codec::lz4;
+            if(name == "zstd")
+                return codec::zstd;
+
+            throw std::invalid_argument{"Unknown compression: " + name};
+        }
+
+        auto to_string(codec c) -> std::string
+        {
+            switch(c)
+            {
+                case codec::none: return "none";
+                case codec::lz4: return "lz4";
+                case codec::zstd: return "zstd";
+            }
+            return "unknown";
+        }
+
+        auto bound(codec c, std::size_t n) noexcept -> std::size_t
+        {
+            switch(c)
+            {
+                case codec::none:
+                    return n;
+
+                case codec::lz4:
+#ifdef PARIS_ENABLE_LZ4
+                    if(n <= static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+                        return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(n)));
+#endif
+                    return n;
+
+                case codec::zstd:
+#ifdef PARIS_ENABLE_ZSTD
+                    return ZSTD_compressBound(n);
+#else
+                    return n;
+#endif
+            }
+            return n;
+        }
+
+        auto compress(codec c, const char* src, std::size_t n, char* dest, std::size_t capacity) -> std::size_t
+        {
+            switch(c)
+            {
+                case codec::none:
+                    break;
+
+                case codec::lz4:
+                {
+#ifdef PARIS_ENABLE_LZ4
+                    auto cap = static_cast<int>(std::min<std::size_t>(capacity, std::numeric_limits<int>::max()));
+                    auto size = LZ4_compress_default(src, dest, lz4_size(n), cap);
+                    if(size <= 0)
+                        throw std::runtime_error{"compression::compress(): lz4 failed"};
+                    return static_cast<std::size_t>(size);
+#else
+                    throw unavailable(c);
+#endif
+                }
+
+                case codec::zstd:
+                {
+#ifdef PARIS_ENABLE_ZSTD
+                    auto size = ZSTD_compress(dest, capacity, src, n, zstd_level);
+                    if(ZSTD_isError(size))
+                        throw std::runtime_error{std::string{"compression::compress(): "} + ZSTD_getErrorName(size)};
+                    return size;
+#else
+                    throw unavailable(c);
+#endif
+                }
+            }
+
+            if(n > capacity)
+                throw std::runtime_error{"compression::compress(): destination too small"};
+            std::copy_n(src, n, dest);
+            return n;
+        }
+
+        auto decompress(codec c, const char* src, std::size_t size, char* dest, std::size_t n) -> void
+        {
+            switch(c)
+            {
+                case codec::none:
+                    break;
+
+                case codec::lz4:
+                {
+#ifdef PARIS_ENABLE_LZ4
+                    auto cap = lz4_size(n);
+                    auto src_size = static_cast<int>(std::min<std::size_t>(size, std::numeric_limits<int>::max()));
+                    if(LZ4_decompress_safe(src, dest, src_size, cap) != cap)
+                        throw std::runtime_error{"compression::decompress(): corrupt lz4 block"};
+                    return;
+#else
+                    throw unavailable(c);
+#endif
+                }
+
+                case codec::zstd:
+                {
+#ifdef PARIS_ENABLE_ZSTD
+                    auto out = ZSTD_decompress(dest, n, src, size);
+                    if(ZSTD_isError(out) || out != n)
+                        throw std::runtime_error{"compression::decompress(): corrupt zstd block"};
+                    return;
+#else
+                    throw unavailable(c);
+#endif
+                }
+            }
+
+            if(size != n)
+                throw std::runtime_error{"compression::decompress(): size mismatch"};
+            std::copy_n(src, n, dest);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_COMPRESSION_H_
+#define PARIS_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace paris
+{
+    namespace compression
+    {
+        // the values are stored in ddbvf files, don't reorder
+        enum class codec : std::uint32_t
+        {
+            none = 0,
+            lz4 = 1,
+            zstd = 2
+        };
+
+        // codecs are optional build dependencies
+        auto available(codec c) noexcept -> bool;
+
+        // throws std::invalid_argument for unknown names
+        auto from_string(const std::string& name) -> codec;
+        auto to_string(codec c) -> std::string;
+
+        // upper limit for the compressed size of n bytes
+        auto bound(codec c, std::size_t n) noexcept -> std::size_t;
+
+        // returns the compressed size, throws std::runtime_error on failure
+        auto compress(codec c, const char* src, std::size_t n, char* dest, std::size_t capacity) -> std::size_t;
+
+        // dest must hold exactly the original n bytes
+        auto decompress(codec c, const char* src, std::size_t size, char* dest, std::size_t n) -> void;
+    }
+}
+
+#endif /* PARIS_COMPRESSION_H_ */
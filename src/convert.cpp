@@ -0,0 +1,283 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PARIS_CONVERT_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define PARIS_CONVERT_X86_SIMD 0
+#endif
+
+#include "convert.h"
+
+namespace paris
+{
+    namespace
+    {
+        auto half_to_float(std::uint16_t h) noexcept -> float
+        {
+            const auto sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+            auto exp = static_cast<std::uint32_t>(h >> 10) & 0x1Fu;
+            auto mant = static_cast<std::uint32_t>(h) & 0x3FFu;
+
+            auto bits = sign;
+            if(exp == 0x1Fu)
+                bits |= 0x7F800000u | (mant << 13);     // inf, nan
+            else if(exp != 0u)
+                bits |= ((exp + 112u) << 23) | (mant << 13);
+            else if(mant != 0u)
+            {
+                // subnormal -> normalise
+                exp = 113u;
+                while((mant & 0x400u) == 0u)
+                {
+                    mant <<= 1;
+                    --exp;
+                }
+                bits |= (exp << 23) | ((mant & 0x3FFu) << 13);
+            }
+
+            auto f = 0.f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+
+        auto float_to_half(float f) noexcept -> std::uint16_t
+        {
+            auto bits = std::uint32_t{};
+            std::memcpy(&bits, &f, sizeof(bits));
+
+            const auto sign = (bits >> 16) & 0x8000u;
+            const auto exp = static_cast<std::int32_t>((bits >> 23) & 0xFFu) - 127 + 15;
+            auto mant = bits & 0x7FFFFFu;
+
+            if(((bits >> 23) & 0xFFu) == 0xFFu)
+                return static_cast<std::uint16_t>(sign | 0x7C00u | (mant != 0u ? 0x200u : 0u));
+            if(exp >= 31)
+                return static_cast<std::uint16_t>(sign | 0x7C00u);
+            if(exp < -10)
+                return static_cast<std::uint16_t>(sign);
+
+            auto half = std::uint32_t{};
+            auto rem = std::uint32_t{};
+            auto halfway = std::uint32_t{};
+            if(exp <= 0)
+            {
+                // subnormal result
+                mant |= 0x800000u;
+                const auto shift = static_cast<std::uint32_t>(14 - exp);
+                half = sign | (mant >> shift);
+                rem = mant & ((1u << shift) - 1u);
+                halfway = 1u << (shift - 1u);
+            }
+            else
+            {
+                half = sign | (static_cast<std::uint32_t>(exp) << 10) | (mant >> 13);
+                rem = mant & 0x1FFFu;
+                halfway = 0x1000u;
+            }
+
+            // a carry out of the mantissa correctly increments the exponent
+            if(rem > halfway || (rem == halfway && (half & 1u) != 0u))
+                ++half;
+
+            return static_cast<std::uint16_t>(half);
+        }
+
+        auto quantise(float f, float offset, float scale) noexcept -> std::uint16_t
+        {
+            auto v = (f - offset) * scale;
+            if(!(v > 0.f))
+                return 0u;      // also catches NaN
+            if(v > 65535.f)
+                return 65535u;
+            return static_cast<std::uint16_t>(std::nearbyint(v));
+        }
+
+        auto convert_to_u16_scalar(const float* src, unsigned char* dest, std::size_t n, float offset,
+                                   float scale) noexcept -> void
+        {
+            for(auto i = std::size_t{0}; i < n; ++i)
+            {
+                const auto q = quantise(src[i], offset, scale);
+                std::memcpy(dest + i * sizeof(q), &q, sizeof(q));
+            }
+        }
+
+#if PARIS_CONVERT_X86_SIMD
+        __attribute__((target("avx2")))
+        auto convert_avx2_u8(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+        {
+            auto i = std::size_t{0};
+            for(; i + 8 <= n; i += 8)
+            {
+                auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+                _mm256_storeu_ps(dest + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)));
+            }
+            convert<std::uint8_t>(src + i, dest + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        auto convert_avx2_u16(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+        {
+            auto i = std::size_t{0};
+            for(; i + 8 <= n; i += 8)
+            {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(std::uint16_t)));
+                _mm256_storeu_ps(dest + i, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v)));
+            }
+            convert<std::uint16_t>(src + i * sizeof(std::uint16_t), dest + i, n - i);
+        }
+
+        __attribute__((target("avx,f16c")))
+        auto convert_f16c(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+        {
+            auto i = std::size_t{0};
+            for(; i + 8 <= n; i += 8)
+            {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(std::uint16_t)));
+                _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(v));
+            }
+            for(; i < n; ++i)
+            {
+                auto h = std::uint16_t{};
+                std::memcpy(&h, src + i * sizeof(h), sizeof(h));
+                dest[i] = half_to_float(h);
+            }
+        }
+
+        __attribute__((target("avx,f16c")))
+        auto convert_to_f16c(const float* src, unsigned char* dest, std::size_t n) noexcept -> void
+        {
+            auto i = std::size_t{0};
+            for(; i + 8 <= n; i += 8)
+            {
+                auto v = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * sizeof(std::uint16_t)), v);
+            }
+            for(; i < n; ++i)
+            {
+                const auto h = float_to_half(src[i]);
+                std::memcpy(dest + i * sizeof(h), &h, sizeof(h));
+            }
+        }
+
+        __attribute__((target("avx2")))
+        auto convert_to_avx2_u16(const float* src, unsigned char* dest, std::size_t n, float offset,
+                                 float scale) noexcept -> void
+        {
+            const auto off = _mm256_set1_ps(offset);
+            const auto sc = _mm256_set1_ps(scale);
+            const auto lo = _mm256_setzero_ps();
+            const auto hi = _mm256_set1_ps(65535.f);
+
+            auto i = std::size_t{0};
+            for(; i + 16 <= n; i += 16)
+            {
+                // max returns the second operand for NaN -> NaN becomes 0 like in the scalar version
+                auto a = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i), off), sc);
+                auto b = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i + 8), off), sc);
+                a = _mm256_min_ps(_mm256_max_ps(a, lo), hi);
+                b = _mm256_min_ps(_mm256_max_ps(b, lo), hi);
+
+                // packus works per 128 bit lane -> restore the element order afterwards
+                auto packed = _mm256_packus_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+                packed = _mm256_permute4x64_epi64(packed, 0xD8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * sizeof(std::uint16_t)), packed);
+            }
+            convert_to_u16_scalar(src + i, dest + i * sizeof(std::uint16_t), n - i, offset, scale);
+        }
+
+        auto has_avx2() noexcept -> bool
+        {
+            static const auto avx2 = static_cast<bool>(__builtin_cpu_supports("avx2"));
+            return avx2;
+        }
+
+        auto has_f16c() noexcept -> bool
+        {
+            static const auto f16c = static_cast<bool>(__builtin_cpu_supports("f16c"));
+            return f16c;
+        }
+#endif
+    }
+
+    auto convert_u8(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+    {
+#if PARIS_CONVERT_X86_SIMD
+        if(has_avx2())
+            return convert_avx2_u8(src, dest, n);
+#endif
+        convert<std::uint8_t>(src, dest, n);
+    }
+
+    auto convert_u16(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+    {
+#if PARIS_CONVERT_X86_SIMD
+        if(has_avx2())
+            return convert_avx2_u16(src, dest, n);
+#endif
+        convert<std::uint16_t>(src, dest, n);
+    }
+
+    auto convert_f16(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+    {
+#if PARIS_CONVERT_X86_SIMD
+        if(has_f16c())
+            return convert_f16c(src, dest, n);
+#endif
+        for(auto i = std::size_t{0}; i < n; ++i)
+        {
+            auto h = std::uint16_t{};
+            std::memcpy(&h, src + i * sizeof(h), sizeof(h));
+            dest[i] = half_to_float(h);
+        }
+    }
+
+    auto convert_to_f16(const float* src, unsigned char* dest, std::size_t n) noexcept -> void
+    {
+#if PARIS_CONVERT_X86_SIMD
+        if(has_f16c())
+            return convert_to_f16c(src, dest, n);
+#endif
+        for(auto i = std::size_t{0}; i < n; ++i)
+        {
+            const auto h = float_to_half(src[i]);
+            std::memcpy(dest + i * sizeof(h), &h, sizeof(h));
+        }
+    }
+
+    auto convert_to_u16(const float* src, unsigned char* dest, std::size_t n, float offset, float scale) noexcept
+        -> void
+    {
+#if PARIS_CONVERT_X86_SIMD
+        if(has_avx2())
+            return convert_to_avx2_u16(src, dest, n, offset, scale);
+#endif
+        convert_to_u16_scalar(src, dest, n, offset, scale);
+    }
+}
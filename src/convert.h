@@ -0,0 +1,56 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_CONVERT_H_
+#define PARIS_CONVERT_H_
+
+#include <cstddef>
+#include <cstring>
+
+namespace paris
+{
+    // the source gives no alignment guarantees -> go through memcpy
+    template <typename T>
+    auto convert(const unsigned char* src, float* dest, std::size_t n) noexcept -> void
+    {
+        for(auto i = std::size_t{0}; i < n; ++i)
+        {
+            auto val = T{};
+            std::memcpy(&val, src + i * sizeof(T), sizeof(T));
+            dest[i] = static_cast<float>(val);
+        }
+    }
+
+    // widening conversions of the integer types are vectorised if the CPU supports it
+    auto convert_u8(const unsigned char* src, float* dest, std::size_t n) noexcept -> void;
+    auto convert_u16(const unsigned char* src, float* dest, std::size_t n) noexcept -> void;
+
+    // IEEE 754 half precision <-> float, rounding to nearest even; vectorised if the CPU supports F16C
+    auto convert_f16(const unsigned char* src, float* dest, std::size_t n) noexcept -> void;
+    auto convert_to_f16(const float* src, unsigned char* dest, std::size_t n) noexcept -> void;
+
+    // round((src - offset) * scale) clamped to [0, 65535], NaN becomes 0; vectorised if the CPU supports AVX2
+    auto convert_to_u16(const float* src, unsigned char* dest, std::size_t n, float offset, float scale) noexcept
+        -> void;
+}
+
+#endif /* PARIS_CONVERT_H_ */
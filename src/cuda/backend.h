@@ -23,7 +23,9 @@
 #ifndef PARIS_CUDA_BACKEND_H_
 #define PARIS_CUDA_BACKEND_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include <cufft.h>
@@ -32,6 +34,7 @@
 #include <glados/cuda/memory.h>
 
 #include "../geometry.h"
+#include "../program_options.h"
 #include "../projection.h"
 #include "../region_of_interest.h"
 #include "../subvolume_information.h"
@@ -78,21 +81,26 @@ namespace paris
         auto copy_h2d(const volume_host_type& h_v, volume_device_type& d_v) -> void;
         auto copy_d2h(const volume_device_type& d_v, volume_host_type& h_v) -> void;
 
-        auto make_subvolume_information(const volume_geometry& vol_geo, const detector_geometry& det_geo)
-            -> subvolume_info;
+        auto make_subvolume_information(const volume_geometry& vol_geo, const program_options& po) -> subvolume_info;
 
-        auto weight(projection_device_type& p, float h_min, float v_min, float d_sd, float l_px_row, float l_px_col)
-            -> void;
+        using weight_buffer_type = glados::cuda::pitched_device_ptr<float>;
+        auto make_weights(std::uint32_t n_row, std::uint32_t n_col, float h_min, float v_min, float d_sd,
+                          float l_px_row, float l_px_col, const std::string& cache_file) -> weight_buffer_type;
 
         using filter_buffer_type = glados::cuda::device_ptr<cufftComplex>;
-        auto make_filter(std::uint32_t size, float tau) -> filter_buffer_type;
-        auto apply_filter(projection_device_type& p, const filter_buffer_type& k, std::uint32_t filter_size,
-                          std::uint32_t n_col) -> void;
+        auto make_filter(std::uint32_t size, float tau, const std::string& cache_file) -> filter_buffer_type;
+        auto apply_filter(std::vector<projection_device_type>& p, const filter_buffer_type& k,
+                          const weight_buffer_type& w, std::uint32_t filter_size, std::uint32_t n_col) -> void;
 
-        auto backproject(const projection_device_type& p, volume_device_type& v, std::uint32_t v_offset,
-                         const detector_geometry& det_geo, const volume_geometry& vol_geo, 
+        // cuFFT plans are cheap to create and cannot be stored
+        inline auto import_fft_plans(const std::string&) -> bool { return false; }
+        inline auto export_fft_plans(const std::string&) -> void {}
+
+        auto backproject(const std::vector<projection_device_type>& p, volume_device_type& v, std::uint32_t v_offset,
+                         const detector_geometry& det_geo, const volume_geometry& vol_geo,
                          bool enable_roi, const region_of_interest& roi,
-                         float sin, float cos, float delta_s, float delta_t) -> void;
+                         const std::vector<float>& sin, const std::vector<float>& cos,
+                         float delta_s, float delta_t, bool skip_invisible) -> void;
 
         /**
          * Device management
@@ -100,6 +108,10 @@ namespace paris
         using device_handle = int;
         auto get_devices() -> std::vector<device_handle>;
         auto set_device(device_handle& device) -> void;
+
+        // filtering and backprojection run on the device, the host threads are not split
+        constexpr auto use_filter_threads(std::uint16_t) noexcept -> int { return 0; }
+        constexpr auto use_backprojection_threads(std::uint16_t) noexcept -> int { return 0; }
     }
 }
 
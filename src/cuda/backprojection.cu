@@ -20,8 +20,10 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
@@ -100,6 +102,10 @@ namespace paris
                     auto z_m = vol_centered_coordinate(m, dev_consts__.vol_dim_z_full,
                                                             dev_consts__.l_vx_z);
 
+                    // voxels outside the field of view cylinder are not reconstructable
+                    if(x_k * x_k + y_l * y_l > dev_consts__.r_fov * dev_consts__.r_fov)
+                        return;
+
                     // rotate coordinates
                     auto s = x_k * angle_cos + y_l * angle_sin;
                     auto t = -x_k * angle_sin + y_l * angle_cos;
@@ -130,116 +136,132 @@ namespace paris
             }
         }
 
-        auto backproject(const projection_device_type& p, volume_device_type& v, std::uint32_t v_offset,
-                         const detector_geometry& det_geo, const volume_geometry& vol_geo,
-                         bool enable_roi, const region_of_interest& roi,
-                         float sin, float cos, float delta_s, float delta_t)  -> void
+        namespace
         {
-            // constants for the backprojection - these never change
-            static const auto v_dim_x_full = vol_geo.dim_x;
-            static const auto v_dim_y_full = vol_geo.dim_y;
-            static const auto v_dim_z_full = vol_geo.dim_z;
-
-            static const auto l_vx_x = vol_geo.l_vx_x;
-            static const auto l_vx_y = vol_geo.l_vx_y;
-            static const auto l_vx_z = vol_geo.l_vx_z;
-
-            static const auto p_dim_x = det_geo.n_row;
-            static const auto p_dim_y = det_geo.n_col;
-
-            static const auto l_px_x = det_geo.l_px_row;
-            static const auto l_px_y = det_geo.l_px_col;
-
-            static const auto d_s = delta_s;
-            static const auto d_t = delta_t;
-
-            static const auto d_so = det_geo.d_so;
-            static const auto d_sd = std::abs(det_geo.d_so) + std::abs(det_geo.d_od);
-
-            // variable for the backprojection - might change between subvolumes
-            thread_local static auto offset = v_offset;
-
-            // local stream
-            thread_local static auto s = cuda_stream{};
-
-            // initialise device constants
-            thread_local static auto consts = backprojection_constants {
-                v.dim_x,
-                v_dim_x_full,
-                v.dim_y,
-                v_dim_y_full,
-                v.dim_z,
-                v_dim_z_full,
-                offset,
-                l_vx_x,
-                l_vx_y,
-                l_vx_z,
-                p_dim_x,
-                p_dim_y,
-                l_px_x,
-                l_px_y,
-                d_s,
-                d_t,
-                d_so,
-                d_sd
-            };
-
-            auto err = cudaMemcpyToSymbolAsync(dev_consts__, &consts, sizeof(consts), 0u, cudaMemcpyHostToDevice,
-                                               s.stream);
-            if(err != cudaSuccess)
+            auto do_backprojection(const projection_device_type& p, volume_device_type& v, std::uint32_t v_offset,
+                                   const detector_geometry& det_geo, const volume_geometry& vol_geo,
+                                   bool enable_roi, const region_of_interest& roi,
+                                   float sin, float cos, float delta_s, float delta_t)  -> void
             {
-                BOOST_LOG_TRIVIAL(fatal) << "Could not initialise device constants: " << cudaGetErrorString(err);
-                throw stage_runtime_error{"backproject() failed"};
-            }
-
-            // create a CUDA texture from the projection
-            auto res_desc = cudaResourceDesc{};
-            res_desc.resType = cudaResourceTypePitch2D;
-            res_desc.res.pitch2D.desc = cudaCreateChannelDesc<float>();
-            res_desc.res.pitch2D.devPtr = reinterpret_cast<void*>(p.buf.get());
-            res_desc.res.pitch2D.width = p.dim_x;
-            res_desc.res.pitch2D.height = p.dim_y;
-            res_desc.res.pitch2D.pitchInBytes = p.buf.pitch();
-
-            auto tex_desc = cudaTextureDesc{};
-            tex_desc.addressMode[0] = cudaAddressModeBorder;
-            tex_desc.addressMode[1] = cudaAddressModeBorder;
-            tex_desc.filterMode = cudaFilterModeLinear;
-            tex_desc.readMode = cudaReadModeElementType;
-            tex_desc.normalizedCoords = 0;
-
-            auto tex = cudaTextureObject_t{0};
-            err = cudaCreateTextureObject(&tex, &res_desc, &tex_desc, nullptr);
-            if(err != cudaSuccess)
-            {
-                BOOST_LOG_TRIVIAL(fatal) << "Could not create CUDA texture: " << cudaGetErrorString(err);
-                throw stage_runtime_error{"backproject() failed"};
-            }
+                // constants for the backprojection - these never change
+                static const auto v_dim_x_full = vol_geo.dim_x;
+                static const auto v_dim_y_full = vol_geo.dim_y;
+                static const auto v_dim_z_full = vol_geo.dim_z;
+
+                static const auto l_vx_x = vol_geo.l_vx_x;
+                static const auto l_vx_y = vol_geo.l_vx_y;
+                static const auto l_vx_z = vol_geo.l_vx_z;
+
+                static const auto p_dim_x = det_geo.n_row;
+                static const auto p_dim_y = det_geo.n_col;
+
+                static const auto l_px_x = det_geo.l_px_row;
+                static const auto l_px_y = det_geo.l_px_col;
+
+                static const auto d_s = delta_s;
+                static const auto d_t = delta_t;
+
+                static const auto d_so = det_geo.d_so;
+                static const auto d_sd = std::abs(det_geo.d_so) + std::abs(det_geo.d_od);
+
+                static const auto r_fov = std::min(static_cast<float>(v_dim_x_full) * l_vx_x,
+                                                   static_cast<float>(v_dim_y_full) * l_vx_y) / 2.f;
+
+                // local stream
+                thread_local static auto s = cuda_stream{};
+
+                // initialise device constants -- dimensions and offset change between subvolumes
+                auto consts = backprojection_constants {
+                    v.dim_x,
+                    v_dim_x_full,
+                    v.dim_y,
+                    v_dim_y_full,
+                    v.dim_z,
+                    v_dim_z_full,
+                    v_offset,
+                    l_vx_x,
+                    l_vx_y,
+                    l_vx_z,
+                    p_dim_x,
+                    p_dim_y,
+                    l_px_x,
+                    l_px_y,
+                    d_s,
+                    d_t,
+                    d_so,
+                    d_sd,
+                    r_fov
+                };
+
+                auto err = cudaMemcpyToSymbolAsync(dev_consts__, &consts, sizeof(consts), 0u, cudaMemcpyHostToDevice,
+                                                   s.stream);
+                if(err != cudaSuccess)
+                {
+                    BOOST_LOG_TRIVIAL(fatal) << "Could not initialise device constants: " << cudaGetErrorString(err);
+                    throw stage_runtime_error{"backproject() failed"};
+                }
 
-            // apply ROI as needed and backproject
-            if(enable_roi)
-            {
-                err = cudaMemcpyToSymbolAsync(dev_roi__, &roi, sizeof(roi), 0u, cudaMemcpyHostToDevice, s.stream);
+                // create a CUDA texture from the projection
+                auto res_desc = cudaResourceDesc{};
+                res_desc.resType = cudaResourceTypePitch2D;
+                res_desc.res.pitch2D.desc = cudaCreateChannelDesc<float>();
+                res_desc.res.pitch2D.devPtr = reinterpret_cast<void*>(p.buf.get());
+                res_desc.res.pitch2D.width = p.dim_x;
+                res_desc.res.pitch2D.height = p.dim_y;
+                res_desc.res.pitch2D.pitchInBytes = p.buf.pitch();
+
+                auto tex_desc = cudaTextureDesc{};
+                tex_desc.addressMode[0] = cudaAddressModeBorder;
+                tex_desc.addressMode[1] = cudaAddressModeBorder;
+                tex_desc.filterMode = cudaFilterModeLinear;
+                tex_desc.readMode = cudaReadModeElementType;
+                tex_desc.normalizedCoords = 0;
+
+                auto tex = cudaTextureObject_t{0};
+                err = cudaCreateTextureObject(&tex, &res_desc, &tex_desc, nullptr);
                 if(err != cudaSuccess)
                 {
-                    BOOST_LOG_TRIVIAL(fatal) << "Could not initialise device ROI: " << cudaGetErrorString(err);
+                    BOOST_LOG_TRIVIAL(fatal) << "Could not create CUDA texture: " << cudaGetErrorString(err);
                     throw stage_runtime_error{"backproject() failed"};
                 }
 
-                glados::cuda::launch_async(s.stream, v.dim_x, v.dim_y, v.dim_z, backprojection_kernel<true>,
-                                           v.buf.get(), v.buf.pitch(), tex, sin, cos);
-            }
-            else
-                glados::cuda::launch_async(s.stream, v.dim_x, v.dim_y, v.dim_z, backprojection_kernel<false>,
-                                           v.buf.get(), v.buf.pitch(), tex, sin, cos);
+                // apply ROI as needed and backproject
+                if(enable_roi)
+                {
+                    err = cudaMemcpyToSymbolAsync(dev_roi__, &roi, sizeof(roi), 0u, cudaMemcpyHostToDevice, s.stream);
+                    if(err != cudaSuccess)
+                    {
+                        BOOST_LOG_TRIVIAL(fatal) << "Could not initialise device ROI: " << cudaGetErrorString(err);
+                        throw stage_runtime_error{"backproject() failed"};
+                    }
 
-            glados::cuda::synchronize_stream(s.stream);
-            err = cudaDestroyTextureObject(tex);
-            if(err != cudaSuccess)
-            {
-                BOOST_LOG_TRIVIAL(fatal) << "Could not destroy CUDA texture: " << cudaGetErrorString(err);
-                throw stage_runtime_error{"backproject() failed"};
+                    glados::cuda::launch_async(s.stream, v.dim_x, v.dim_y, v.dim_z, backprojection_kernel<true>,
+                                               v.buf.get(), v.buf.pitch(), tex, sin, cos);
+                }
+                else
+                    glados::cuda::launch_async(s.stream, v.dim_x, v.dim_y, v.dim_z, backprojection_kernel<false>,
+                                               v.buf.get(), v.buf.pitch(), tex, sin, cos);
+
+                glados::cuda::synchronize_stream(s.stream);
+                err = cudaDestroyTextureObject(tex);
+                if(err != cudaSuccess)
+                {
+                    BOOST_LOG_TRIVIAL(fatal) << "Could not destroy CUDA texture: " << cudaGetErrorString(err);
+                    throw stage_runtime_error{"backproject() failed"};
+                }
             }
         }
+
+        auto backproject(const std::vector<projection_device_type>& p, volume_device_type& v, std::uint32_t v_offset,
+                         const detector_geometry& det_geo, const volume_geometry& vol_geo,
+                         bool enable_roi, const region_of_interest& roi,
+                         const std::vector<float>& sin, const std::vector<float>& cos,
+                         float delta_s, float delta_t, bool /* skip_invisible */) -> void
+        {
+            // one kernel launch per projection -- the volume already resides in device memory
+            for(auto i = 0u; i < p.size(); ++i)
+                do_backprojection(p[i], v, v_offset, det_geo, vol_geo, enable_roi, roi, sin[i], cos[i],
+                                  delta_s, delta_t);
+        }
     }
 }
@@ -53,6 +53,8 @@ namespace paris
 
             float d_so;
             float d_sd;
+
+            float r_fov;
         };
 }
 
@@ -22,7 +22,8 @@
 
 #include <algorithm>
 #include <cstdint>
-#include <numeric>
+#include <string>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
@@ -49,7 +50,7 @@ namespace paris
                 auto x = glados::cuda::coord_x();
 
                 /*
-                 * r(j) with j = [ -(filter_length - 2) / 2, ..., 0, ..., filter_length / 2 ]
+                 * r(j) with j = [ 0, ..., filter_length / 2, -(filter_length - 1) / 2, ..., -1 ]
                  * tau = horizontal pixel distance
                  *
                  *          1/8 * 1/(tau^2)                     for j = 0
@@ -73,12 +74,12 @@ namespace paris
             } 
 
             __global__ void k_creation_kernel(cufftComplex* __restrict__ data,
-                                              std::uint32_t filter_size, float tau)
+                                              std::uint32_t filter_size, float scale)
             {
                 auto x = glados::cuda::coord_x();
                 if(x < filter_size)
                 {
-                    auto result = tau * fabsf(sqrtf(powf(data[x].x, 2.f)
+                    auto result = scale * fabsf(sqrtf(powf(data[x].x, 2.f)
                                   + powf(data[x].y, 2.f)));
 
                     data[x].x = result;
@@ -105,18 +106,29 @@ namespace paris
                 }
             }
 
-            __global__ void normalization_kernel(cufftReal* dst, std::size_t pitch,
-                                                 std::uint32_t width, std::uint32_t height,
-                                                 std::uint32_t filter_size)
+            __global__ void expansion_kernel(cufftReal* __restrict__ dst, std::size_t dst_pitch,
+                                             const float* __restrict__ src, std::size_t src_pitch,
+                                             const float* __restrict__ w, std::size_t w_pitch,
+                                             std::uint32_t src_width, std::uint32_t dst_width,
+                                             std::uint32_t height)
             {
                 auto x = glados::cuda::coord_x();
                 auto y = glados::cuda::coord_y();
 
-                if((x < width) && (y < height))
+                if((x < dst_width) && (y < height))
                 {
-                    auto row = reinterpret_cast<cufftReal*>(reinterpret_cast<char*>(dst) + y * pitch);
+                    auto dst_row = reinterpret_cast<cufftReal*>(reinterpret_cast<char*>(dst) + y * dst_pitch);
 
-                    row[x] /= filter_size;
+                    if(x < src_width)
+                    {
+                        auto src_row = reinterpret_cast<const float*>(reinterpret_cast<const char*>(src)
+                                        + y * src_pitch);
+                        auto w_row = reinterpret_cast<const float*>(reinterpret_cast<const char*>(w) + y * w_pitch);
+
+                        dst_row[x] = src_row[x] * w_row[x];
+                    }
+                    else
+                        dst_row[x] = 0.f;
                 }
             }
 
@@ -126,13 +138,13 @@ namespace paris
                 /*
                  * for a more detailed description see filter_creation_kernel
                  */
-                /* create j on the host and fill it with values from
-                 * -(filter_size_ - 2) / 2 to filter_size / 2
+                /* create j on the host and fill it with values from 0 to filter_size / 2, followed by
+                 * -(filter_size - 1) / 2 to -1 -> the kernel is symmetric for even and odd sizes
                  */
                 auto h_j = glados::cuda::make_unique_pinned_host<std::int32_t>(filter_size);
                 auto size = static_cast<std::int32_t>(filter_size);
-                auto j = -(size - 2) / 2;
-                std::iota(h_j.get(), h_j.get() + filter_size, j);
+                for(auto x = 0; x < size; ++x)
+                    h_j[x] = (x <= size / 2) ? x : x - size;
 
                 // create j on the device and copy j from the host to the device
                 auto d_j = glados::cuda::make_unique_device<std::int32_t>(filter_size);
@@ -150,15 +162,17 @@ namespace paris
                 return d_r;
             }
 
-            auto expand(const projection_device_buffer_type& src, std::uint32_t src_dim_x,
+            auto expand(const projection_device_buffer_type& src, const weight_buffer_type& w, std::uint32_t src_dim_x,
                               glados::cuda::pitched_device_ptr<float>& dst, std::uint32_t dst_dim_x,
                               std::uint32_t dim_y, cudaStream_t& stream) -> void
             {
-                // reset the expansion destination
-                glados::cuda::fill(glados::cuda::async, dst, 0, stream, dst_dim_x, dim_y);
-
-                // copy original projection to expanded projection
-                glados::cuda::copy(glados::cuda::async, dst, src, stream, src_dim_x, dim_y);
+                // copy weighted original projection to expanded projection and zero the padding
+                glados::cuda::launch_async(stream, dst_dim_x, dim_y,
+                                           expansion_kernel,
+                                           dst.get(), dst.pitch(),
+                                           static_cast<const float*>(src.get()), src.pitch(),
+                                           static_cast<const float*>(w.get()), w.pitch(),
+                                           src_dim_x, dst_dim_x, dim_y);
             }
 
             auto shrink(const glados::cuda::pitched_device_ptr<float>& src,
@@ -167,9 +181,80 @@ namespace paris
             {
                 glados::cuda::copy(glados::cuda::async, dst, src, stream, dim_x, dim_y);
             }
+
+            auto filter_projection(projection_device_type& p, const filter_buffer_type& k, const weight_buffer_type& w,
+                                   std::uint32_t filter_size, std::uint32_t n_col)
+                -> void
+            {
+                /* due to cuFFT's crazy API we cannot make the constants which we need as pointers actually const
+                 * - this applies to n, p_exp_nembed and p_trans_nembed
+                 */
+
+                // dimensionality of the FFT - 1 in this case
+                constexpr auto rank = 1;
+
+                // FFT size for each dimension
+                static auto n = static_cast<int>(filter_size);
+
+                // batched FFT -> set batch size
+                static const auto batch = static_cast<int>(n_col);
+
+                // allocate memory for expanded projection (projection width -> filter size)
+                thread_local static auto p_exp = glados::cuda::make_unique_device<float>(filter_size, n_col);
+
+                // allocate memory for transformed projection
+                static const auto size_trans = filter_size / 2 + 1;
+                thread_local static auto p_trans = glados::cuda::make_unique_device<cufftComplex>(size_trans, n_col);
+
+                // set distance between the first elements of two successive lines
+                static const auto p_exp_dist = static_cast<int>(p_exp.pitch() / sizeof(float));
+                static const auto p_trans_dist = static_cast<int>(p_trans.pitch() / sizeof(cufftComplex));
+
+                // set distance between two successive elements
+                constexpr auto p_exp_stride = 1;
+                constexpr auto p_trans_stride = 1;
+
+                // set storage dimensions of data in memory
+                static auto p_exp_nembed = static_cast<int>(p_exp_dist);
+                static auto p_trans_nembed = static_cast<int>(p_trans_dist);
+
+                // create plans for forward and inverse FFT
+                thread_local static auto forward = glados::cufft::plan<CUFFT_R2C>{rank, &n,
+                                                                    &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                                    &p_trans_nembed, p_trans_stride, p_trans_dist,
+                                                                    batch};
+
+                thread_local static auto inverse = glados::cufft::plan<CUFFT_C2R>{rank, &n,
+                                                                    &p_trans_nembed, p_trans_stride, p_trans_dist,
+                                                                    &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                                    batch};
+
+                // create stream for filtering and assign to plans
+                thread_local static auto s = cuda_stream{};
+                forward.set_stream(s.stream);
+                inverse.set_stream(s.stream);
+
+                // weight, expand and transform the projection
+                expand(p.buf, w, p.dim_x, p_exp, filter_size, n_col, s.stream);
+                forward.execute(p_exp.get(), p_trans.get());
+
+                // apply filter to transformed projection
+                glados::cuda::launch_async(s.stream, size_trans, n_col,
+                                           filter_application_kernel,
+                                           p_trans.get(), static_cast<const cufftComplex*>(k.get()),
+                                           size_trans, n_col, p_trans.pitch());
+
+                // inverse transformation
+                inverse.execute(p_trans.get(), p_exp.get());
+
+                // shrink to original size, the filter already contains the normalization
+                shrink(p_exp, p.buf, p.dim_x, n_col, s.stream);
+
+                glados::cuda::synchronize_stream(s.stream);
+            }
         }
 
-        auto make_filter(std::uint32_t size, float tau) -> filter_buffer_type
+        auto make_filter(std::uint32_t size, float tau, const std::string& /* cache_file */) -> filter_buffer_type
         {
             auto r = make_filter_real(size, tau);
 
@@ -181,83 +266,20 @@ namespace paris
             auto plan = glados::cufft::plan<CUFFT_R2C>{n};
             plan.execute(r.get(), k.get());
 
-            glados::cuda::launch(size_trans, k_creation_kernel, k.get(), size_trans, tau);
+            // cuFFT's inverse transform is unnormalized -> fold 1 / size into the filter
+            auto scale = tau / static_cast<float>(size);
+            glados::cuda::launch(size_trans, k_creation_kernel, k.get(), size_trans, scale);
 
             return k;
         }
 
-        auto apply_filter(projection_device_type& p, const filter_buffer_type& k,
-                          std::uint32_t filter_size, std::uint32_t n_col)
+        auto apply_filter(std::vector<projection_device_type>& p, const filter_buffer_type& k,
+                          const weight_buffer_type& w, std::uint32_t filter_size, std::uint32_t n_col)
             -> void
         {
-            /* due to cuFFT's crazy API we cannot make the constants which we need as pointers actually const
-             * - this applies to n, p_exp_nembed and p_trans_nembed
-             */
-
-            // dimensionality of the FFT - 1 in this case
-            constexpr auto rank = 1;
-
-            // FFT size for each dimension
-            static auto n = static_cast<int>(filter_size);
-
-            // batched FFT -> set batch size
-            static const auto batch = static_cast<int>(n_col);
-
-            // allocate memory for expanded projection (projection width -> filter size)
-            thread_local static auto p_exp = glados::cuda::make_unique_device<float>(filter_size, n_col);
-
-            // allocate memory for transformed projection
-            static const auto size_trans = filter_size / 2 + 1;
-            thread_local static auto p_trans = glados::cuda::make_unique_device<cufftComplex>(size_trans, n_col);
-
-            // set distance between the first elements of two successive lines
-            static const auto p_exp_dist = static_cast<int>(p_exp.pitch() / sizeof(float));
-            static const auto p_trans_dist = static_cast<int>(p_trans.pitch() / sizeof(cufftComplex));
-
-            // set distance between two successive elements
-            constexpr auto p_exp_stride = 1;
-            constexpr auto p_trans_stride = 1;
-
-            // set storage dimensions of data in memory
-            static auto p_exp_nembed = static_cast<int>(p_exp_dist);
-            static auto p_trans_nembed = static_cast<int>(p_trans_dist);
-
-            // create plans for forward and inverse FFT
-            thread_local static auto forward = glados::cufft::plan<CUFFT_R2C>{rank, &n,
-                                                                &p_exp_nembed, p_exp_stride, p_exp_dist,
-                                                                &p_trans_nembed, p_trans_stride, p_trans_dist,
-                                                                batch};
-
-            thread_local static auto inverse = glados::cufft::plan<CUFFT_C2R>{rank, &n,
-                                                                &p_trans_nembed, p_trans_stride, p_trans_dist,
-                                                                &p_exp_nembed, p_exp_stride, p_exp_dist,
-                                                                batch};
-
-            // create stream for filtering and assign to plans
-            thread_local static auto s = cuda_stream{};
-            forward.set_stream(s.stream);
-            inverse.set_stream(s.stream);
-
-            // expand and transform the projection
-            expand(p.buf, p.dim_x, p_exp, filter_size, n_col, s.stream);
-            forward.execute(p_exp.get(), p_trans.get());
-
-            // apply filter to transformed projection
-            glados::cuda::launch_async(s.stream, size_trans, n_col,
-                                       filter_application_kernel,
-                                       p_trans.get(), static_cast<const cufftComplex*>(k.get()),
-                                       size_trans, n_col, p_trans.pitch());
-
-            // inverse transformation
-            inverse.execute(p_trans.get(), p_exp.get());
-
-            // shrink to original size and normalize
-            shrink(p_exp, p.buf, p.dim_x, n_col, s.stream);
-            glados::cuda::launch_async(s.stream, p.dim_x, p.dim_y,
-                                       normalization_kernel,
-                                       p.buf.get(), p.buf.pitch(), p.dim_x, p.dim_y, filter_size);
-
-            glados::cuda::synchronize_stream(s.stream);
+            // cuFFT already saturates the device with the rows of a single projection
+            for(auto& proj : p)
+                filter_projection(proj, k, w, filter_size, n_col);
         }
     }
 }
@@ -31,6 +31,7 @@
 
 #include "../exception.h"
 #include "../geometry.h"
+#include "../program_options.h"
 #include "../subvolume_information.h"
 #include "backend.h"
 
@@ -60,15 +61,14 @@ namespace paris
             }
         }
 
-        auto make_subvolume_information(const volume_geometry& vol_geo, const detector_geometry& det_geo)
-            -> subvolume_info
+        auto make_subvolume_information(const volume_geometry& vol_geo, const program_options& po) -> subvolume_info
         {
             auto sce = paris::stage_construction_error{"create_subvolume_information() failed"};
 
             try
             {
                 auto subvol_info = subvolume_info{};
-                auto info = memory_info(vol_geo, det_geo);
+                auto info = memory_info(vol_geo, po.det_geo);
                 auto mem_needed = info.vol + 10u * info.proj;
 
                 auto devices = glados::cuda::get_device_count();
@@ -114,6 +114,7 @@ namespace paris
                 subvol_info.geo.dim_z = vol_geo.dim_z / vols_needed;
                 subvol_info.geo.remainder = vol_geo.dim_z % vols_needed;
                 subvol_info.num = static_cast<int>(vols_needed);
+                subvol_info.projection_cache = po.projection_cache;
 
                 return subvol_info;
             }
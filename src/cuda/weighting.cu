@@ -20,6 +20,8 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <string>
+
 #include <glados/cuda/coordinates.h>
 #include <glados/cuda/launch.h>
 #include <glados/cuda/utility.h>
@@ -32,7 +34,7 @@ namespace paris
     {
         namespace
         {
-            __global__ void weighting_kernel(float* p, std::uint32_t dim_x, std::uint32_t dim_y, std::size_t pitch,
+            __global__ void weighting_kernel(float* w, std::uint32_t dim_x, std::uint32_t dim_y, std::size_t pitch,
                                              float h_min, float v_min, float d_sd, float l_px_row, float l_px_col)
             {
                 auto s = glados::cuda::coord_x();
@@ -40,36 +42,33 @@ namespace paris
 
                 if((s < dim_x) && (t < dim_y))
                 {
-                    auto row = reinterpret_cast<float*>(reinterpret_cast<char*>(p) + t * pitch);
-
-                    // enable parallel global memory fetch while calculating
-                    const auto val = row[s];
+                    auto row = reinterpret_cast<float*>(reinterpret_cast<char*>(w) + t * pitch);
 
                     // detector coordinates in mm
                     const auto h_s = (l_px_row / 2.f) + s * l_px_row + h_min;
                     const auto v_t = (l_px_col / 2.f) + t * l_px_col + v_min;
 
                     // calculate weight
-                    const auto w_st = d_sd * rsqrtf(powf(d_sd, 2) + powf(h_s, 2) + powf(v_t, 2));
-
-                    // write value
-                    row[s] = val * w_st;
+                    row[s] = d_sd * rsqrtf(powf(d_sd, 2) + powf(h_s, 2) + powf(v_t, 2));
                 }
             }
 
         } 
 
-        auto weight(projection_device_type& p, float h_min, float v_min, float d_sd, float l_px_row, float l_px_col)
-            -> void
+        auto make_weights(std::uint32_t n_row, std::uint32_t n_col, float h_min, float v_min, float d_sd,
+                          float l_px_row, float l_px_col, const std::string& /* cache_file */) -> weight_buffer_type
         {
-            thread_local static auto s = cuda_stream{};
-            
-            glados::cuda::launch_async(s.stream, p.dim_x, p.dim_y,
-                                        weighting_kernel,
-                                        p.buf.get(), p.dim_x, p.dim_y, p.buf.pitch(),
-                                        h_min, v_min, d_sd, l_px_row, l_px_col);
+            auto w = glados::cuda::make_unique_device<float>(n_row, n_col);
+
+            auto s = cuda_stream{};
+
+            glados::cuda::launch_async(s.stream, n_row, n_col,
+                                       weighting_kernel,
+                                       w.get(), n_row, n_col, w.pitch(),
+                                       h_min, v_min, d_sd, l_px_row, l_px_col);
 
             glados::cuda::synchronize_stream(s.stream);
+            return w;
         }
         
     }
@@ -21,19 +21,33 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cerrno>
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
-#include <ios>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <boost/log/trivial.hpp>
 
+#include "compression.h"
+#include "convert.h"
 #include "ddbvf.h"
+#include "mapped_file.h"
 #include "volume.h"
 
 namespace paris
@@ -44,6 +58,8 @@ namespace paris
         {
             constexpr auto ddbvf_id = 0xEFDDDAFA;
             constexpr auto ddbvf_version = 0x0010;
+            constexpr auto ddbvf_typed_version = 0x0011;
+            constexpr auto ddbvf_chunked_version = 0x0020;
 
             // as all types are the same we don't need to consider padding here
             struct header
@@ -56,45 +72,629 @@ namespace paris
             
             constexpr auto offset_pos = sizeof(ddbvf_id) + sizeof(ddbvf_version) + sizeof(header) - sizeof(header::offset);
             constexpr auto first_pos = 32;
+
+            // version 0x0011 stores the element type behind the version 1 header, the data starts at 64
+            struct typed_header
+            {
+                std::uint32_t type;
+                float window_min;
+                float window_max;
+            };
+
+            constexpr auto typed_header_pos = sizeof(ddbvf_id) + sizeof(ddbvf_version) + sizeof(header);
+            constexpr auto typed_first_pos = std::size_t{64};
+
+            // version 2 header, stored at chunked_header_pos; index_pos is 0 until the file is complete
+            struct chunked_header
+            {
+                std::uint32_t dim_x;
+                std::uint32_t dim_y;
+                std::uint32_t dim_z;
+                std::uint32_t chunk_x;
+                std::uint32_t chunk_y;
+                std::uint32_t chunk_z;
+                std::uint32_t codec;
+                std::uint32_t type;
+                std::uint64_t index_pos;
+                float window_min;
+                float window_max;
+            };
+
+            constexpr auto chunked_header_pos = sizeof(ddbvf_id) + sizeof(ddbvf_version);
+            constexpr auto chunked_first_pos = std::size_t{64};
+
+            // size 0 marks a chunk of zeros, a chunk that did not shrink is stored uncompressed
+            struct chunk_entry
+            {
+                std::uint64_t pos;
+                std::uint64_t size;
+            };
+
+            // chunk layer that received only some of its slices so far
+            struct partial_layer
+            {
+                std::unique_ptr<float[]> buf;
+                std::uint32_t filled;
+            };
         }
 
         struct handle
         {
+            ~handle()
+            {
+                if(direct_fd != -1)
+                    ::close(direct_fd);
+                if(fd != -1)
+                    ::close(fd);
+            }
+
             header head;
-            std::fstream stream;
+            int fd = -1;
+            int direct_fd = -1;     // second descriptor with O_DIRECT, -1 if disabled
+
+            std::uint32_t version = ddbvf_version;
+            typed_header typed = {};
+            std::unique_ptr<mapped_file> map;   // volumes opened for reading only
+
+            // version 2 only
+            chunked_header chunked = {};
+            std::vector<chunk_entry> index;
+            std::atomic<std::uint64_t> end{chunked_first_pos};
+            bool finished = false;
+
+            std::mutex mutex;
+            std::map<std::uint32_t, partial_layer> layers;
         };
 
+        namespace
+        {
+            // O_DIRECT needs block-aligned buffers, offsets and sizes, 4 KiB covers all common devices
+            constexpr auto direct_alignment = std::size_t{4096};
+
+            // smaller writes go through the page cache
+            constexpr auto direct_threshold = std::size_t{16} * 1024 * 1024;
+            constexpr auto direct_chunk = std::size_t{8} * 1024 * 1024;
+
+            auto write_all(int fd, const char* buf, std::size_t size, std::size_t pos) -> void
+            {
+                while(size > 0u)
+                {
+                    auto n = ::pwrite(fd, buf, size, static_cast<off_t>(pos));
+                    if(n == -1)
+                    {
+                        if(errno == EINTR)
+                            continue;
+                        throw std::system_error{errno, std::generic_category()};
+                    }
+                    buf += n;
+                    size -= static_cast<std::size_t>(n);
+                    pos += static_cast<std::size_t>(n);
+                }
+            }
+
+            auto read_all(int fd, char* buf, std::size_t size, std::size_t pos) -> bool
+            {
+                while(size > 0u)
+                {
+                    auto n = ::pread(fd, buf, size, static_cast<off_t>(pos));
+                    if(n == -1)
+                    {
+                        if(errno == EINTR)
+                            continue;
+                        throw std::system_error{errno, std::generic_category()};
+                    }
+                    if(n == 0)
+                        return false;
+                    buf += n;
+                    size -= static_cast<std::size_t>(n);
+                    pos += static_cast<std::size_t>(n);
+                }
+                return true;
+            }
+
+            struct aligned_deleter { auto operator()(void* p) noexcept -> void { std::free(p); } };
+
+            // the aligned middle part of the range goes through O_DIRECT via an aligned bounce buffer
+            auto write_direct(const handle& h, const char* buf, std::size_t size, std::size_t pos) -> void
+            {
+                const auto begin = (pos + direct_alignment - 1u) / direct_alignment * direct_alignment;
+                const auto end = (pos + size) / direct_alignment * direct_alignment;
+
+                void* mem = nullptr;
+                if(::posix_memalign(&mem, direct_alignment, direct_chunk) != 0)
+                    throw std::system_error{ENOMEM, std::generic_category()};
+                auto bounce = std::unique_ptr<char, aligned_deleter>{static_cast<char*>(mem)};
+
+                write_all(h.fd, buf, begin - pos, pos);
+                for(auto chunk_pos = begin; chunk_pos < end; chunk_pos += direct_chunk)
+                {
+                    const auto chunk_size = std::min(direct_chunk, end - chunk_pos);
+                    std::copy_n(buf + (chunk_pos - pos), chunk_size, bounce.get());
+                    write_all(h.direct_fd, bounce.get(), chunk_size, chunk_pos);
+                }
+                write_all(h.fd, buf + (end - pos), pos + size - end, end);
+            }
+
+            auto type_of(const handle& h) noexcept -> element_type
+            {
+                return static_cast<element_type>(h.typed.type);
+            }
+
+            // uint16 maps [window_min, window_max] to [0, 65535]
+            auto quantisation_scale(const handle& h) noexcept -> float
+            {
+                const auto width = h.typed.window_max - h.typed.window_min;
+                return width > 0.f ? 65535.f / width : 1.f;
+            }
+
+            auto encode(const handle& h, const float* src, char* dest, std::size_t n) -> void
+            {
+                const auto out = reinterpret_cast<unsigned char*>(dest);
+                switch(type_of(h))
+                {
+                    case element_type::float32:
+                        std::memcpy(dest, src, n * sizeof(float));
+                        return;
+
+                    case element_type::uint16:
+                        return convert_to_u16(src, out, n, h.typed.window_min, quantisation_scale(h));
+
+                    case element_type::float16:
+                        return convert_to_f16(src, out, n);
+                }
+                throw std::runtime_error{"ddbvf: unknown element type"};
+            }
+
+            auto decode(const handle& h, const char* src, float* dest, std::size_t n) -> void
+            {
+                const auto in = reinterpret_cast<const unsigned char*>(src);
+                switch(type_of(h))
+                {
+                    case element_type::float32:
+                        std::memcpy(dest, src, n * sizeof(float));
+                        return;
+
+                    case element_type::uint16:
+                    {
+                        convert_u16(in, dest, n);
+                        const auto step = 1.f / quantisation_scale(h);
+                        const auto offset = h.typed.window_min;
+                        std::transform(dest, dest + n, dest, [step, offset](float q) { return q * step + offset; });
+                        return;
+                    }
+
+                    case element_type::float16:
+                        return convert_f16(in, dest, n);
+                }
+                throw std::runtime_error{"ddbvf: unknown element type"};
+            }
+
+            // position of the first voxel of version 1 files
+            auto data_pos(const handle& h) noexcept -> std::size_t
+            {
+                return sizeof(ddbvf_id) + sizeof(ddbvf_version) + sizeof(header) + h.head.offset;
+            }
+
+            auto chunk_count(std::uint32_t dim, std::uint32_t chunk) noexcept -> std::uint32_t
+            {
+                return (dim + chunk - 1u) / chunk;
+            }
+
+            auto chunk_extent(std::uint32_t dim, std::uint32_t chunk, std::uint32_t c) noexcept -> std::uint32_t
+            {
+                return std::min(chunk, dim - c * chunk);
+            }
+
+            auto chunk_index(const chunked_header& ch, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz) noexcept
+                -> std::size_t
+            {
+                const auto nx = std::size_t{chunk_count(ch.dim_x, ch.chunk_x)};
+                const auto ny = std::size_t{chunk_count(ch.dim_y, ch.chunk_y)};
+                return (cz * ny + cy) * nx + cx;
+            }
+
+            // a complete layer of chunks, base points to its first slice
+            struct layer_job
+            {
+                const float* base;
+                std::uint32_t cz;
+                std::unique_ptr<float[]> owner;
+            };
+
+            auto write_chunk(handle& h, const float* base, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz,
+                             std::vector<float>& raw, std::vector<char>& encoded, std::vector<char>& packed) -> void
+            {
+                const auto& ch = h.chunked;
+                const auto x0 = cx * ch.chunk_x;
+                const auto y0 = cy * ch.chunk_y;
+                const auto w = chunk_extent(ch.dim_x, ch.chunk_x, cx);
+                const auto ht = chunk_extent(ch.dim_y, ch.chunk_y, cy);
+                const auto d = chunk_extent(ch.dim_z, ch.chunk_z, cz);
+
+                raw.resize(std::size_t{w} * ht * d);
+                auto out = raw.data();
+                for(auto z = 0u; z < d; ++z)
+                {
+                    for(auto y = 0u; y < ht; ++y)
+                    {
+                        const auto row = base + (std::size_t{z} * ch.dim_y + y0 + y) * ch.dim_x + x0;
+                        out = std::copy_n(row, w, out);
+                    }
+                }
+
+                const auto raw_size = raw.size() * element_size(type_of(h));
+                encoded.resize(raw_size);
+                encode(h, raw.data(), encoded.data(), raw.size());
+                const auto raw_data = static_cast<const char*>(encoded.data());
+                auto& entry = h.index[chunk_index(ch, cx, cy, cz)];
+
+                // air outside the object compresses to nothing at all
+                if(std::all_of(raw_data, raw_data + raw_size, [](char c) { return c == 0; }))
+                {
+                    entry = chunk_entry{0u, 0u};
+                    return;
+                }
+
+                const auto codec = static_cast<compression::codec>(ch.codec);
+                packed.resize(compression::bound(codec, raw_size));
+                auto size = compression::compress(codec, raw_data, raw_size, packed.data(), packed.size());
+
+                auto data = static_cast<const char*>(packed.data());
+                if(size >= raw_size)
+                {
+                    data = raw_data;
+                    size = raw_size;
+                }
+
+                // chunks are appended in the order they are finished, the index records where they went
+                const auto pos = h.end.fetch_add(size);
+                write_all(h.fd, data, size, pos);
+                entry = chunk_entry{pos, size};
+            }
+
+            // compresses all chunks of the given layers in parallel
+            auto write_layers(handle& h, const std::vector<layer_job>& jobs) -> void
+            {
+                if(jobs.empty())
+                    return;
+
+                const auto& ch = h.chunked;
+                const auto nx = chunk_count(ch.dim_x, ch.chunk_x);
+                const auto ny = chunk_count(ch.dim_y, ch.chunk_y);
+                const auto per_layer = std::size_t{nx} * ny;
+                const auto total = per_layer * jobs.size();
+
+                const auto hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+                const auto thread_num = std::min<std::size_t>(std::min(hw_threads, 16u), total);
+
+                std::atomic<std::size_t> next{0u};
+                auto errors = std::vector<std::exception_ptr>(thread_num);
+                auto threads = std::vector<std::thread>{};
+                threads.reserve(thread_num);
+                for(auto t = std::size_t{0}; t < thread_num; ++t)
+                {
+                    threads.emplace_back([&, t]()
+                    {
+                        auto raw = std::vector<float>{};
+                        auto encoded = std::vector<char>{};
+                        auto packed = std::vector<char>{};
+                        try
+                        {
+                            for(auto i = next++; i < total; i = next++)
+                            {
+                                const auto& job = jobs[i / per_layer];
+                                const auto c = i % per_layer;
+                                write_chunk(h, job.base, static_cast<std::uint32_t>(c % nx),
+                                            static_cast<std::uint32_t>(c / nx), job.cz, raw, encoded, packed);
+                            }
+                        }
+                        catch(...)
+                        {
+                            errors[t] = std::current_exception();
+                            next = total;
+                        }
+                    });
+                }
+
+                for(auto&& t : threads)
+                    t.join();
+
+                for(auto&& e : errors)
+                {
+                    if(e != nullptr)
+                        std::rethrow_exception(e);
+                }
+            }
+
+            auto write_chunked(handle& h, const volume_type& vol, std::uint32_t first) -> void
+            {
+                const auto& ch = h.chunked;
+                const auto slice_size = std::size_t{ch.dim_x} * ch.dim_y;
+                const auto last = first + vol.dim_z;
+
+                // layers covered completely are compressed straight from the volume, subvolume boundaries
+                // usually cut through a layer -> collect its slices until the layer is complete
+                auto jobs = std::vector<layer_job>{};
+                for(auto cz = first / ch.chunk_z; cz * ch.chunk_z < last; ++cz)
+                {
+                    const auto z0 = cz * ch.chunk_z;
+                    const auto depth = chunk_extent(ch.dim_z, ch.chunk_z, cz);
+                    const auto begin = std::max(z0, first);
+                    const auto end = std::min(z0 + depth, last);
+
+                    if(begin == z0 && end == z0 + depth)
+                    {
+                        jobs.push_back(layer_job{vol.buf.get() + (z0 - first) * slice_size, cz, nullptr});
+                        continue;
+                    }
+
+                    auto&& lock = std::lock_guard<std::mutex>{h.mutex};
+                    auto& layer = h.layers[cz];
+                    if(layer.buf == nullptr)
+                        layer.buf.reset(new float[std::size_t{depth} * slice_size]);
+
+                    std::copy_n(vol.buf.get() + (begin - first) * slice_size, (end - begin) * slice_size,
+                                layer.buf.get() + (begin - z0) * slice_size);
+                    layer.filled += end - begin;
+
+                    if(layer.filled == depth)
+                    {
+                        auto buf = std::move(layer.buf);
+                        h.layers.erase(cz);
+                        jobs.push_back(layer_job{buf.get(), cz, std::move(buf)});
+                    }
+                }
+
+                write_layers(h, jobs);
+            }
+
+            auto write_header(const handle& h) -> void
+            {
+                auto buf = std::array<char, chunked_first_pos>{};
+                std::memcpy(buf.data(), &ddbvf_id, sizeof(ddbvf_id));
+                std::memcpy(buf.data() + sizeof(ddbvf_id), &h.version, sizeof(ddbvf_version));
+
+                if(h.version == ddbvf_chunked_version)
+                {
+                    auto ch = h.chunked;
+                    ch.type = h.typed.type;
+                    ch.window_min = h.typed.window_min;
+                    ch.window_max = h.typed.window_max;
+                    std::memcpy(buf.data() + chunked_header_pos, &ch, sizeof(ch));
+                    write_all(h.fd, buf.data(), chunked_first_pos, 0u);
+                }
+                else if(h.version == ddbvf_typed_version)
+                {
+                    std::memcpy(buf.data() + sizeof(ddbvf_id) + sizeof(ddbvf_version), &h.head, sizeof(h.head));
+                    std::memcpy(buf.data() + typed_header_pos, &h.typed, sizeof(h.typed));
+                    write_all(h.fd, buf.data(), typed_first_pos, 0u);
+                }
+                else
+                {
+                    std::memcpy(buf.data() + sizeof(ddbvf_id) + sizeof(ddbvf_version), &h.head, sizeof(h.head));
+                    write_all(h.fd, buf.data(), first_pos, 0u);
+                }
+            }
+
+            // the region of the volume a read covers
+            struct box
+            {
+                std::uint32_t x;
+                std::uint32_t y;
+                std::uint32_t z;
+                std::uint32_t nx;
+                std::uint32_t ny;
+                std::uint32_t nz;
+            };
+
+            auto mapping(const handle& h) -> const mapped_file&
+            {
+                if(h.map == nullptr)
+                    throw std::runtime_error{"ddbvf: volume was not opened for reading"};
+                return *h.map;
+            }
+
+            // decodes chunk (cx, cy, cz) from the mapping, raw is scratch space
+            auto load_chunk(const handle& h, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, float* dest,
+                            std::vector<char>& raw) -> void
+            {
+                const auto& ch = h.chunked;
+                const auto& map = mapping(h);
+                const auto n = std::size_t{chunk_extent(ch.dim_x, ch.chunk_x, cx)}
+                               * chunk_extent(ch.dim_y, ch.chunk_y, cy) * chunk_extent(ch.dim_z, ch.chunk_z, cz);
+                const auto raw_size = n * element_size(type_of(h));
+                const auto& entry = h.index[chunk_index(ch, cx, cy, cz)];
+
+                if(entry.pos > map.size() || entry.size > map.size() - entry.pos)
+                    throw std::runtime_error{"ddbvf: truncated file"};
+
+                const auto src = reinterpret_cast<const char*>(map.data()) + entry.pos;
+                if(entry.size == raw_size)
+                    return decode(h, src, dest, n);
+
+                // chunks of size 0 hold zero bytes
+                raw.resize(raw_size);
+                if(entry.size == 0u)
+                    std::fill(std::begin(raw), std::end(raw), 0);
+                else
+                {
+                    compression::decompress(static_cast<compression::codec>(ch.codec), src, entry.size, raw.data(),
+                                            raw_size);
+                }
+                decode(h, raw.data(), dest, n);
+            }
+
+            auto read_raw(const handle& h, const box& b, float* dest) -> void
+            {
+                const auto& map = mapping(h);
+                const auto esize = element_size(type_of(h));
+                const auto base = reinterpret_cast<const char*>(map.data()) + data_pos(h);
+                const auto dim_x = std::size_t{h.head.dim_x};
+                const auto dim_y = std::size_t{h.head.dim_y};
+
+                for(auto z = std::size_t{b.z}; z < b.z + b.nz; ++z)
+                {
+                    const auto first = (z * dim_y + b.y) * dim_x + b.x;
+
+                    // whole rows are contiguous in the file
+                    if(b.nx == dim_x)
+                    {
+                        const auto n = std::size_t{b.ny} * dim_x;
+                        map.prefetch(data_pos(h) + first * esize, n * esize);
+                        decode(h, base + first * esize, dest, n);
+                        dest += n;
+                        continue;
+                    }
+
+                    for(auto y = std::size_t{0}; y < b.ny; ++y)
+                    {
+                        decode(h, base + (first + y * dim_x) * esize, dest, b.nx);
+                        dest += b.nx;
+                    }
+                }
+            }
+
+            // decompresses the chunks overlapping the region in parallel, each fills a disjoint part of dest
+            auto read_chunked(const handle& h, const box& b, float* dest) -> void
+            {
+                const auto& ch = h.chunked;
+                const auto cx0 = b.x / ch.chunk_x;
+                const auto cy0 = b.y / ch.chunk_y;
+                const auto cz0 = b.z / ch.chunk_z;
+                const auto ncx = (b.x + b.nx - 1u) / ch.chunk_x - cx0 + 1u;
+                const auto ncy = (b.y + b.ny - 1u) / ch.chunk_y - cy0 + 1u;
+                const auto ncz = (b.z + b.nz - 1u) / ch.chunk_z - cz0 + 1u;
+                const auto total = std::size_t{ncx} * ncy * ncz;
+
+                const auto hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+                const auto thread_num = std::min<std::size_t>(std::min(hw_threads, 16u), total);
+
+                std::atomic<std::size_t> next{0u};
+                auto errors = std::vector<std::exception_ptr>(thread_num);
+                auto threads = std::vector<std::thread>{};
+                threads.reserve(thread_num);
+                for(auto t = std::size_t{0}; t < thread_num; ++t)
+                {
+                    threads.emplace_back([&, t]()
+                    {
+                        auto chunk = std::vector<float>(std::size_t{ch.chunk_x} * ch.chunk_y * ch.chunk_z);
+                        auto raw = std::vector<char>{};
+                        try
+                        {
+                            for(auto i = next++; i < total; i = next++)
+                            {
+                                const auto cx = cx0 + static_cast<std::uint32_t>(i % ncx);
+                                const auto cy = cy0 + static_cast<std::uint32_t>(i / ncx % ncy);
+                                const auto cz = cz0 + static_cast<std::uint32_t>(i / ncx / ncy);
+                                load_chunk(h, cx, cy, cz, chunk.data(), raw);
+
+                                // overlap of chunk and region in volume coordinates
+                                const auto w = chunk_extent(ch.dim_x, ch.chunk_x, cx);
+                                const auto ht = chunk_extent(ch.dim_y, ch.chunk_y, cy);
+                                const auto x0 = std::max(b.x, cx * ch.chunk_x);
+                                const auto x1 = std::min(b.x + b.nx, cx * ch.chunk_x + w);
+                                const auto y0 = std::max(b.y, cy * ch.chunk_y);
+                                const auto y1 = std::min(b.y + b.ny, cy * ch.chunk_y + ht);
+                                const auto z0 = std::max(b.z, cz * ch.chunk_z);
+                                const auto z1 = std::min(b.z + b.nz, cz * ch.chunk_z
+                                                                     + chunk_extent(ch.dim_z, ch.chunk_z, cz));
+
+                                for(auto z = z0; z < z1; ++z)
+                                {
+                                    for(auto y = y0; y < y1; ++y)
+                                    {
+                                        const auto src = chunk.data()
+                                                         + (std::size_t{z - cz * ch.chunk_z} * ht
+                                                            + (y - cy * ch.chunk_y)) * w + (x0 - cx * ch.chunk_x);
+                                        const auto out = dest + (std::size_t{z - b.z} * b.ny + (y - b.y)) * b.nx
+                                                         + (x0 - b.x);
+                                        std::copy_n(src, x1 - x0, out);
+                                    }
+                                }
+                            }
+                        }
+                        catch(...)
+                        {
+                            errors[t] = std::current_exception();
+                            next = total;
+                        }
+                    });
+                }
+
+                for(auto&& t : threads)
+                    t.join();
+
+                for(auto&& e : errors)
+                {
+                    if(e != nullptr)
+                        std::rethrow_exception(e);
+                }
+            }
+        }
+
         auto handle_deleter::operator()(handle* h) noexcept -> void
         {
             delete h;
         }
 
-        auto create(const std::string& path, std::uint32_t dim_x, std::uint32_t dim_y, std::uint32_t dim_z) -> handle_type
+        auto create(const std::string& path, std::uint32_t dim_x, std::uint32_t dim_y, std::uint32_t dim_z,
+                    bool direct_io, compression::codec codec, std::uint32_t chunk_size, element_type type)
+            -> handle_type
         {
             auto full_path = path + ".ddbvf";
 
+            if(!compression::available(codec))
+                throw std::runtime_error{"ddbvf::create(): PARIS was built without " + compression::to_string(codec)
+                                         + " support"};
+
             auto h = handle_type{new handle};
             h->head = {dim_x, dim_y, dim_z, 0u};
+            h->typed = {static_cast<std::uint32_t>(type), 0.f, 0.f};
 
-            // the first 32 bytes are reserved for the file header
-            h->head.offset = first_pos - sizeof(ddbvf_id) - sizeof(ddbvf_version) - sizeof(h->head);
+            // the first 32 bytes are reserved for the file header, 64 if it includes the element type
+            auto data_start = std::size_t{first_pos};
+            if(type != element_type::float32)
+            {
+                h->version = ddbvf_typed_version;
+                data_start = typed_first_pos;
+            }
+            h->head.offset = static_cast<std::uint32_t>(data_start - sizeof(ddbvf_id) - sizeof(ddbvf_version)
+                                                        - sizeof(h->head));
 
-            h->stream.open(full_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            h->fd = ::open(full_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(h->fd == -1)
+                throw std::system_error{errno, std::generic_category()};
 
-            // write file header
-            h->stream.write(reinterpret_cast<const char*>(&ddbvf_id), sizeof(ddbvf_id));
-            h->stream.write(reinterpret_cast<const char*>(&ddbvf_version), sizeof(ddbvf_version));
-            h->stream.write(reinterpret_cast<char*>(&h->head), sizeof(h->head));
-            
-            // fill remaining bytes with zeroes
-            auto buf = std::unique_ptr<char[]>{new char[h->head.offset]};
-            std::fill_n(buf.get(), h->head.offset, 0);
-            h->stream.write(buf.get(), static_cast<std::streamsize>(h->head.offset));
+            if(codec != compression::codec::none)
+            {
+                if(chunk_size == 0u)
+                    throw std::runtime_error{"ddbvf::create(): chunk size must be greater than 0"};
 
-            // check for errors
-            if(!h->stream)
+                // the chunk sizes are unknown until compressed -> the file grows as chunks are appended
+                h->version = ddbvf_chunked_version;
+                h->chunked = chunked_header{dim_x, dim_y, dim_z, chunk_size, chunk_size, chunk_size,
+                                            static_cast<std::uint32_t>(codec), 0u, 0u, 0.f, 0.f};
+                h->index.resize(std::size_t{chunk_count(dim_x, chunk_size)} * chunk_count(dim_y, chunk_size)
+                                * chunk_count(dim_z, chunk_size));
+                write_header(*h);
+                return h;
+            }
+
+            // reserve the whole file up front -> no fragmentation, concurrent writers never extend the file
+            const auto size = static_cast<off_t>(data_start + std::size_t{dim_x} * dim_y * dim_z * element_size(type));
+            if(::posix_fallocate(h->fd, 0, size) != 0 && ::ftruncate(h->fd, size) == -1)
                 throw std::system_error{errno, std::generic_category()};
 
+            // write file header, remaining bytes up to the data are zero
+            write_header(*h);
+
+            if(direct_io)
+            {
+                h->direct_fd = ::open(full_path.c_str(), O_WRONLY | O_DIRECT);
+                if(h->direct_fd == -1)
+                    BOOST_LOG_TRIVIAL(warning) << "ddbvf::create(): " << full_path << " does not support direct I/O";
+            }
+
             return h;
         }
 
@@ -102,30 +702,100 @@ namespace paris
         {
             auto h = handle_type{new handle};
 
-            h->stream.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+            h->fd = ::open(path.c_str(), O_RDONLY);
+            if(h->fd == -1)
+                throw std::system_error{errno, std::generic_category()};
 
             auto id = std::uint32_t{};
             auto version = std::uint16_t{};
-            
+
             // read file header
-            h->stream.read(reinterpret_cast<char*>(&id), sizeof(id));
-            if(id != ddbvf_id)
+            if(!read_all(h->fd, reinterpret_cast<char*>(&id), sizeof(id), 0u) || id != ddbvf_id)
                 throw std::runtime_error{"Not a ddbvf file: " + path};
 
-            h->stream.read(reinterpret_cast<char*>(&version), sizeof(version));
-            if(version != ddbvf_version)
+            if(!read_all(h->fd, reinterpret_cast<char*>(&version), sizeof(version), sizeof(id))
+               || (version != ddbvf_version && version != ddbvf_typed_version && version != ddbvf_chunked_version))
                 throw std::runtime_error{"Unsupported ddbvf version: " + path};
 
-            h->stream.read(reinterpret_cast<char*>(&h->head), sizeof(h->head));
+            h->version = version;
+            h->finished = true;
+            if(version != ddbvf_chunked_version)
+            {
+                if(!read_all(h->fd, reinterpret_cast<char*>(&h->head), sizeof(h->head),
+                             sizeof(id) + sizeof(ddbvf_version)))
+                    throw std::runtime_error{"Truncated ddbvf file: " + path};
 
-            // check for errors
-            if(!h->stream)
-                throw std::system_error{errno, std::generic_category()};
+                if(version == ddbvf_typed_version
+                   && !read_all(h->fd, reinterpret_cast<char*>(&h->typed), sizeof(h->typed), typed_header_pos))
+                    throw std::runtime_error{"Truncated ddbvf file: " + path};
+
+                if(h->typed.type > static_cast<std::uint32_t>(element_type::float16))
+                    throw std::runtime_error{"Unsupported ddbvf element type: " + path};
+
+                // slices are read straight from the mapping, consumers usually look at a few of them
+                h->map.reset(new mapped_file{path, false});
+                const auto size = data_pos(*h) + std::size_t{h->head.dim_x} * h->head.dim_y * h->head.dim_z
+                                                 * element_size(type_of(*h));
+                if(h->map->size() < size)
+                    throw std::runtime_error{"Truncated ddbvf file: " + path};
+
+                return h;
+            }
+
+            auto& ch = h->chunked;
+            if(!read_all(h->fd, reinterpret_cast<char*>(&ch), sizeof(ch), chunked_header_pos))
+                throw std::runtime_error{"Truncated ddbvf file: " + path};
+
+            if(ch.index_pos == 0u)
+                throw std::runtime_error{"Incomplete ddbvf file: " + path};
+
+            if(ch.chunk_x == 0u || ch.chunk_y == 0u || ch.chunk_z == 0u
+               || !compression::available(static_cast<compression::codec>(ch.codec)))
+                throw std::runtime_error{"Unsupported ddbvf compression: " + path};
 
+            if(ch.type > static_cast<std::uint32_t>(element_type::float16))
+                throw std::runtime_error{"Unsupported ddbvf element type: " + path};
+
+            h->head = {ch.dim_x, ch.dim_y, ch.dim_z, 0u};
+            h->typed = {ch.type, ch.window_min, ch.window_max};
+            h->index.resize(std::size_t{chunk_count(ch.dim_x, ch.chunk_x)} * chunk_count(ch.dim_y, ch.chunk_y)
+                            * chunk_count(ch.dim_z, ch.chunk_z));
+            if(!read_all(h->fd, reinterpret_cast<char*>(h->index.data()), h->index.size() * sizeof(chunk_entry),
+                         ch.index_pos))
+                throw std::runtime_error{"Truncated ddbvf file: " + path};
+
+            h->map.reset(new mapped_file{path, false});
             return h;
         }
 
-        auto write(handle_type& h, const volume_type& vol, std::uint32_t first) -> void
+        auto get_info(const handle_type& h) -> info
+        {
+            if(h->version != ddbvf_chunked_version)
+            {
+                return info{static_cast<std::uint16_t>(h->version), h->head.dim_x, h->head.dim_y, h->head.dim_z,
+                            h->head.dim_x, h->head.dim_y, h->head.dim_z, compression::codec::none, type_of(*h),
+                            h->typed.window_min, h->typed.window_max};
+            }
+
+            const auto& ch = h->chunked;
+            return info{ddbvf_chunked_version, ch.dim_x, ch.dim_y, ch.dim_z, ch.chunk_x, ch.chunk_y, ch.chunk_z,
+                        static_cast<compression::codec>(ch.codec), type_of(*h), h->typed.window_min,
+                        h->typed.window_max};
+        }
+
+        auto element_size(element_type type) noexcept -> std::size_t
+        {
+            return type == element_type::float32 ? sizeof(float) : sizeof(std::uint16_t);
+        }
+
+        auto set_window(const handle_type& h, float min, float max) -> void
+        {
+            h->typed.window_min = min;
+            h->typed.window_max = max;
+            write_header(*h);
+        }
+
+        auto write(const handle_type& h, const volume_type& vol, std::uint32_t first) -> void
         {
             if(h == nullptr || vol.buf == nullptr)
                 return;
@@ -137,19 +807,99 @@ namespace paris
             if(vol.dim_x != h->head.dim_x || vol.dim_y != h->head.dim_y || vol.dim_z > h->head.dim_z)
                 throw std::runtime_error{"ddbvf::write(): Attempting to save volume to file with wrong dimensions"};
 
+            if(h->version == ddbvf_chunked_version)
+                return write_chunked(*h, vol, first);
+
             // calculate size and offset for writing
-            using element_type = typename decltype(volume_type::buf)::element_type;
-            auto write_size = static_cast<std::streamsize>(vol.dim_x * vol.dim_y * vol.dim_z * sizeof(element_type));
-            auto write_pos = static_cast<std::fstream::off_type>(vol.dim_x * vol.dim_y * first * sizeof(element_type));
+            const auto esize = element_size(type_of(*h));
+            const auto slice_size = std::size_t{vol.dim_x} * vol.dim_y * esize;
+            const auto write_size = slice_size * vol.dim_z;
+            const auto write_pos = data_pos(*h) + slice_size * first;
+
+            // positional writes -> subvolumes can be saved concurrently
+            if(type_of(*h) == element_type::float32)
+            {
+                const auto data = reinterpret_cast<const char*>(vol.buf.get());
+                if(h->direct_fd != -1 && write_size >= direct_threshold)
+                    write_direct(*h, data, write_size, write_pos);
+                else
+                    write_all(h->fd, data, write_size, write_pos);
+                return;
+            }
 
-            // write data
-            h->stream.seekp(first_pos);
-            h->stream.seekp(write_pos, std::ios_base::cur);
-            h->stream.write(reinterpret_cast<char*>(vol.buf.get()), write_size);
+            // convert piecewise while writing, the converted volume never exists as a whole
+            const auto count = std::size_t{vol.dim_x} * vol.dim_y * vol.dim_z;
+            const auto block = direct_chunk / esize;
+            auto buf = std::vector<char>(std::min(count, block) * esize);
+            for(auto i = std::size_t{0}; i < count; i += block)
+            {
+                const auto n = std::min(block, count - i);
+                encode(*h, vol.buf.get() + i, buf.data(), n);
+                write_all(h->fd, buf.data(), n * esize, write_pos + i * esize);
+            }
+        }
 
-            // check for errors
-            if(!h->stream)
-                throw std::system_error{errno, std::generic_category()};
+        auto finish(const handle_type& h) -> void
+        {
+            if(h == nullptr || h->version != ddbvf_chunked_version || h->finished)
+                return;
+
+            if(!h->layers.empty())
+                throw std::runtime_error{"ddbvf::finish(): volume is incomplete"};
+
+            // the index goes behind the last chunk, setting index_pos in the header marks the file as complete
+            const auto index_pos = h->end.load();
+            write_all(h->fd, reinterpret_cast<const char*>(h->index.data()), h->index.size() * sizeof(chunk_entry),
+                      index_pos);
+
+            h->chunked.index_pos = index_pos;
+            write_header(*h);
+            h->finished = true;
+        }
+
+        auto read_chunk(const handle_type& h, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, float* dest)
+            -> void
+        {
+            if(h->version != ddbvf_chunked_version)
+                throw std::runtime_error{"ddbvf::read_chunk(): volume is not chunked"};
+
+            const auto& ch = h->chunked;
+            if(cx >= chunk_count(ch.dim_x, ch.chunk_x) || cy >= chunk_count(ch.dim_y, ch.chunk_y)
+               || cz >= chunk_count(ch.dim_z, ch.chunk_z))
+                throw std::runtime_error{"ddbvf::read_chunk(): chunk out of bounds"};
+
+            auto raw = std::vector<char>{};
+            load_chunk(*h, cx, cy, cz, dest, raw);
+        }
+
+        auto read_region(const handle_type& h, std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t nx,
+                         std::uint32_t ny, std::uint32_t nz) -> volume_type
+        {
+            const auto& head = h->head;
+            if(nx == 0u || ny == 0u || nz == 0u || x >= head.dim_x || y >= head.dim_y || z >= head.dim_z
+               || nx > head.dim_x - x || ny > head.dim_y - y || nz > head.dim_z - z)
+                throw std::runtime_error{"ddbvf::read_region(): region out of bounds"};
+
+            auto vol = backend::make_volume_host(nx, ny, nz);
+            vol.off = z;
+
+            const auto b = box{x, y, z, nx, ny, nz};
+            if(h->version == ddbvf_chunked_version)
+                read_chunked(*h, b, vol.buf.get());
+            else
+                read_raw(*h, b, vol.buf.get());
+
+            return vol;
+        }
+
+        auto read_slab(const handle_type& h, std::uint32_t z_first, std::uint32_t z_count) -> volume_type
+        {
+            return read_region(h, 0u, 0u, z_first, h->head.dim_x, h->head.dim_y, z_count);
+        }
+
+        auto read_slice(const handle_type& h, std::uint32_t z) -> volume_type
+        {
+            return read_slab(h, z, 1u);
         }
     }
 }
@@ -23,11 +23,13 @@
 #ifndef PARIS_DDBVF_H_
 #define PARIS_DDBVF_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
 
 #include "backend.h"
+#include "compression.h"
 #include "volume.h"
 
 namespace paris
@@ -40,10 +42,76 @@ namespace paris
 
         using volume_type = backend::volume_host_type;
 
+        // the values are stored in ddbvf files, don't reorder
+        enum class element_type : std::uint32_t
+        {
+            float32 = 0,
+            uint16 = 1,
+            float16 = 2
+        };
+
+        auto element_size(element_type type) noexcept -> std::size_t;
+
+        /**
+         * Version 1 stores the raw slices behind the header, version 0x0011 adds the element type for uint16 and
+         * float16 volumes. uint16 voxels map [window_min, window_max] linearly to [0, 65535]. Version 2 splits the
+         * volume into chunks of chunk_x * chunk_y * chunk_z voxels which are compressed independently and located
+         * through a chunk index, so a subregion can be read without decompressing the whole file. Edge chunks are
+         * clipped to the volume.
+         */
+        struct info
+        {
+            std::uint16_t version;
+            std::uint32_t dim_x;
+            std::uint32_t dim_y;
+            std::uint32_t dim_z;
+            std::uint32_t chunk_x;
+            std::uint32_t chunk_y;
+            std::uint32_t chunk_z;
+            compression::codec codec;
+            element_type type;
+            float window_min;
+            float window_max;
+        };
+
         auto open(const std::string& path) -> handle_type;
-        auto create(const std::string& path, std::uint32_t dim_x, std::uint32_t dim_y, std::uint32_t dim_z)
-            -> handle_type;
-        auto write(handle_type& h, const volume_type& vol, std::uint32_t first) -> void;
+
+        auto get_info(const handle_type& h) -> info;
+
+        /**
+         * Creates the file. Uncompressed volumes are preallocated and written in version 1, with direct_io large
+         * float32 writes bypass the page cache where the file system supports it. Compressed volumes are written in
+         * version 2 with cubic chunks of chunk_size voxels per side. Voxels are converted to type while writing.
+         */
+        auto create(const std::string& path, std::uint32_t dim_x, std::uint32_t dim_y, std::uint32_t dim_z,
+                    bool direct_io = false, compression::codec codec = compression::codec::none,
+                    std::uint32_t chunk_size = 64, element_type type = element_type::float32) -> handle_type;
+
+        // uint16 volumes need the window before the first write
+        auto set_window(const handle_type& h, float min, float max) -> void;
+
+        // writes vol to slices [first, first + vol.dim_z), several threads may write disjoint slices concurrently
+        auto write(const handle_type& h, const volume_type& vol, std::uint32_t first) -> void;
+
+        // completes the file after all slices were written, writes the chunk index of version 2 files
+        auto finish(const handle_type& h) -> void;
+
+        /*
+         * The read functions need a volume opened with open(), which maps the file. Voxels are converted to float,
+         * x varies fastest. Only the chunks of version 2 files that overlap the region are decompressed.
+         */
+
+        // decompresses chunk (cx, cy, cz) of a version 2 file into dest
+        auto read_chunk(const handle_type& h, std::uint32_t cx, std::uint32_t cy, std::uint32_t cz, float* dest)
+            -> void;
+
+        // the region starting at (x, y, z) with nx * ny * nz voxels, off of the result is z
+        auto read_region(const handle_type& h, std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t nx,
+                         std::uint32_t ny, std::uint32_t nz) -> volume_type;
+
+        // slices [z_first, z_first + z_count)
+        auto read_slab(const handle_type& h, std::uint32_t z_first, std::uint32_t z_count) -> volume_type;
+        auto read_slice(const handle_type& h, std::uint32_t z) -> volume_type;
     }
 }
 
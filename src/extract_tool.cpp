@@ -0,0 +1,258 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include "ddbvf.h"
+#include "version.h"
+
+/*
+ * paris.extract - copies slices or a region of a ddbvf volume to a raw float32 file or a multi-page float32 TIFF.
+ * Only the requested part of the volume is read.
+ */
+namespace
+{
+    struct options
+    {
+        std::string input_path;
+        std::string output_path;
+        std::string format;
+        std::uint32_t x1, x2, y1, y2, z1, z2;
+        bool has_x, has_y, has_z;
+    };
+
+    auto make_options(int argc, char** argv) -> options
+    {
+        auto opts = options{};
+        try
+        {
+            auto slice = std::uint32_t{};
+
+            boost::program_options::options_description desc{"Options"};
+            desc.add_options()
+                    ("help", "produce a help message")
+                    ("input", boost::program_options::value<std::string>(&opts.input_path)->required(), "Path to the ddbvf volume")
+                    ("output", boost::program_options::value<std::string>(&opts.output_path)->required(), "Path of the extracted file")
+                    ("format", boost::program_options::value<std::string>(&opts.format)->default_value("tiff"), "Output format: tiff or raw (optional)")
+                    ("slice", boost::program_options::value<std::uint32_t>(&slice), "Extract a single slice, shorthand for --z1 n --z2 n+1 (optional)")
+                    ("x1", boost::program_options::value<std::uint32_t>(&opts.x1), "leftmost coordinate (optional)")
+                    ("x2", boost::program_options::value<std::uint32_t>(&opts.x2), "rightmost coordinate, exclusive (optional)")
+                    ("y1", boost::program_options::value<std::uint32_t>(&opts.y1), "uppermost coordinate (optional)")
+                    ("y2", boost::program_options::value<std::uint32_t>(&opts.y2), "lowest coordinate, exclusive (optional)")
+                    ("z1", boost::program_options::value<std::uint32_t>(&opts.z1), "first slice (optional)")
+                    ("z2", boost::program_options::value<std::uint32_t>(&opts.z2), "last slice, exclusive (optional)");
+
+            boost::program_options::variables_map param_map;
+            boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), param_map);
+
+            if(param_map.count("help"))
+            {
+                std::cout << desc << std::endl;
+                std::exit(EXIT_SUCCESS);
+            }
+
+            boost::program_options::notify(param_map);
+
+            if(opts.format != "tiff" && opts.format != "raw")
+            {
+                std::cerr << "the option '--format' must be tiff or raw" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
+            auto print_missing = [](const char* str)
+            {
+                std::cerr << "the option '--" << str << "' is required but missing" << std::endl;
+                std::exit(EXIT_FAILURE);
+            };
+
+            // a missing axis covers the whole volume
+            opts.has_x = param_map.count("x1") || param_map.count("x2");
+            if(opts.has_x && param_map.count("x1") == 0) print_missing("x1");
+            if(opts.has_x && param_map.count("x2") == 0) print_missing("x2");
+
+            opts.has_y = param_map.count("y1") || param_map.count("y2");
+            if(opts.has_y && param_map.count("y1") == 0) print_missing("y1");
+            if(opts.has_y && param_map.count("y2") == 0) print_missing("y2");
+
+            if(param_map.count("slice"))
+            {
+                if(param_map.count("z1") || param_map.count("z2"))
+                {
+                    std::cerr << "the option '--slice' cannot be combined with '--z1' or '--z2'" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+                opts.z1 = slice;
+                opts.z2 = slice + 1u;
+                opts.has_z = true;
+            }
+            else
+            {
+                opts.has_z = param_map.count("z1") || param_map.count("z2");
+                if(opts.has_z && param_map.count("z1") == 0) print_missing("z1");
+                if(opts.has_z && param_map.count("z2") == 0) print_missing("z2");
+            }
+        }
+        catch(const boost::program_options::error& err)
+        {
+            std::cerr << err.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        return opts;
+    }
+
+    template <typename T>
+    auto put(std::vector<char>& buf, T value) -> void
+    {
+        auto bytes = std::array<char, sizeof(T)>{};
+        std::memcpy(bytes.data(), &value, sizeof(T));
+        buf.insert(std::end(buf), std::begin(bytes), std::end(bytes));
+    }
+
+    // baseline TIFF, little endian, one uncompressed strip per page
+    auto write_tiff(std::ofstream& out, const float* data, std::uint32_t width, std::uint32_t height,
+                    std::uint32_t pages) -> void
+    {
+        constexpr auto header_size = std::size_t{8};
+        constexpr auto entries = std::uint16_t{10};
+        constexpr auto ifd_size = std::size_t{2} + entries * std::size_t{12} + 4u;
+
+        const auto page_size = std::size_t{width} * height * sizeof(float);
+        const auto total = header_size + pages * (page_size + ifd_size);
+        if(total > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error{"region too large for TIFF, use --format raw"};
+
+        auto head = std::vector<char>{'I', 'I'};
+        put(head, std::uint16_t{42});
+        put(head, static_cast<std::uint32_t>(header_size + page_size));
+        out.write(head.data(), static_cast<std::streamsize>(head.size()));
+
+        // every page is followed by its directory
+        for(auto p = 0u; p < pages; ++p)
+        {
+            const auto strip = header_size + p * (page_size + ifd_size);
+            out.write(reinterpret_cast<const char*>(data + std::size_t{p} * width * height),
+                      static_cast<std::streamsize>(page_size));
+
+            auto ifd = std::vector<char>{};
+            put(ifd, entries);
+            auto entry = [&ifd](std::uint16_t tag, std::uint16_t type, std::uint32_t value)
+            {
+                put(ifd, tag);
+                put(ifd, type);
+                put(ifd, std::uint32_t{1});
+                if(type == 3u)
+                {
+                    put(ifd, static_cast<std::uint16_t>(value));
+                    put(ifd, std::uint16_t{0});
+                }
+                else
+                    put(ifd, value);
+            };
+
+            constexpr auto short_type = std::uint16_t{3};
+            constexpr auto long_type = std::uint16_t{4};
+            entry(256, long_type, width);                                   // ImageWidth
+            entry(257, long_type, height);                                  // ImageLength
+            entry(258, short_type, 32u);                                    // BitsPerSample
+            entry(259, short_type, 1u);                                     // Compression: none
+            entry(262, short_type, 1u);                                     // PhotometricInterpretation: BlackIsZero
+            entry(273, long_type, static_cast<std::uint32_t>(strip));       // StripOffsets
+            entry(277, short_type, 1u);                                     // SamplesPerPixel
+            entry(278, long_type, height);                                  // RowsPerStrip
+            entry(279, long_type, static_cast<std::uint32_t>(page_size));   // StripByteCounts
+            entry(339, short_type, 3u);                                     // SampleFormat: IEEE float
+
+            const auto next = p + 1u < pages ? strip + page_size + ifd_size + page_size : std::size_t{0};
+            put(ifd, static_cast<std::uint32_t>(next));
+            out.write(ifd.data(), static_cast<std::streamsize>(ifd.size()));
+        }
+    }
+
+    auto extract(const options& opts) -> void
+    {
+        auto h = paris::ddbvf::open(opts.input_path);
+        const auto info = paris::ddbvf::get_info(h);
+
+        const auto x1 = opts.has_x ? opts.x1 : 0u;
+        const auto x2 = opts.has_x ? opts.x2 : info.dim_x;
+        const auto y1 = opts.has_y ? opts.y1 : 0u;
+        const auto y2 = opts.has_y ? opts.y2 : info.dim_y;
+        const auto z1 = opts.has_z ? opts.z1 : 0u;
+        const auto z2 = opts.has_z ? opts.z2 : info.dim_z;
+        if(x2 <= x1 || y2 <= y1 || z2 <= z1)
+            throw std::runtime_error{"empty region"};
+
+        const auto vol = paris::ddbvf::read_region(h, x1, y1, z1, x2 - x1, y2 - y1, z2 - z1);
+
+        auto&& out = std::ofstream{opts.output_path.c_str(), std::ios::binary | std::ios::trunc};
+        if(!out)
+            throw std::runtime_error{"cannot open " + opts.output_path};
+
+        if(opts.format == "tiff")
+            write_tiff(out, vol.buf.get(), vol.dim_x, vol.dim_y, vol.dim_z);
+        else
+        {
+            out.write(reinterpret_cast<const char*>(vol.buf.get()),
+                      static_cast<std::streamsize>(std::size_t{vol.dim_x} * vol.dim_y * vol.dim_z * sizeof(float)));
+        }
+
+        if(!out)
+            throw std::runtime_error{"failed to write " + opts.output_path};
+
+        BOOST_LOG_TRIVIAL(info) << "Wrote " << vol.dim_x << " x " << vol.dim_y << " x " << vol.dim_z
+                                << " float32 voxels to " << opts.output_path;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    std::cout << "paris.extract - version " << paris::version << std::endl;
+
+    auto opts = make_options(argc, argv);
+
+    try
+    {
+        extract(opts);
+    }
+    catch(const std::exception& err)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "paris.extract failed: " << err.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -66,6 +66,12 @@ namespace paris
         return ret;
     }
 
+    auto is_regular_file(const std::string& path) -> bool
+    {
+        auto ec = boost::system::error_code{};
+        return boost::filesystem::is_regular_file(boost::filesystem::path{path}, ec);
+    }
+
     auto create_directory(const std::string& path) -> bool
     {
         try
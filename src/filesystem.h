@@ -29,6 +29,7 @@
 namespace paris
 {
 	auto read_directory(const std::string&) -> std::vector<std::string>;
+	auto is_regular_file(const std::string&) -> bool;
 	auto create_directory(const std::string&) -> bool;
 }
 
@@ -20,27 +20,73 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
-#include <cmath>
 #include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
 
 #include "backend.h"
+#include "cache.h"
 #include "filtering.h"
 #include "geometry.h"
+#include "weighting.h"
 
 namespace paris
 {
-    auto filter(backend::projection_device_type& p, const detector_geometry& det_geo)
+    namespace
+    {
+        // smallest length >= n whose only prime factors are 2, 3, 5 and 7 -> fast FFTs
+        auto next_smooth_size(std::uint32_t n) noexcept -> std::uint32_t
+        {
+            for(auto m = n;; ++m)
+            {
+                auto r = m;
+                for(auto f : {2u, 3u, 5u, 7u})
+                {
+                    while(r % f == 0u)
+                        r /= f;
+                }
+
+                if(r == 1u)
+                    return m;
+            }
+        }
+
+        auto import_plans(const std::string& cache_dir) -> bool
+        {
+            if(cache_dir.empty())
+                return false;
+
+            return backend::import_fft_plans(cache_dir + "/fft_plans");
+        }
+    }
+
+    auto filter(std::vector<backend::projection_device_type>& p, const detector_geometry& det_geo,
+                const std::string& cache_path)
         noexcept(true && noexcept(backend::apply_filter))
         -> void
     {
         // the following variables are static and global -> initialise once
-        static const auto filter_size = static_cast<std::uint32_t>(2 * std::pow(2.f, std::ceil(std::log2(det_geo.n_row))));
+        // linear convolution of n_row samples needs at least 2 * n_row - 1 points
+        static const auto filter_size = next_smooth_size(2u * det_geo.n_row - 1u);
         static const auto n_col = det_geo.n_col;
         static const auto tau = det_geo.l_px_row;
+        static const auto cache_dir = cache_path.empty() ? std::string{}
+                                                         : make_cache_directory(cache_path, det_geo, filter_size);
+
+        // the following variables are static and thread local -> initialise once per thread (= device)
+        thread_local static const auto plans_cached = import_plans(cache_dir);
+        thread_local static const auto k = backend::make_filter(filter_size, tau, cache_file(cache_dir, "filter"));
+        thread_local static const auto w = make_weights(det_geo, cache_dir);
 
-        // the following variable is static and thread local -> initialise once per thread (= device)
-        thread_local static const auto k = backend::make_filter(filter_size, tau);
+        backend::apply_filter(p, k, w, filter_size, n_col);
 
-        backend::apply_filter(p, k, filter_size, n_col);
+        // all plans exist after the first batch -> store them for the next run
+        thread_local static auto plans_stored = plans_cached || cache_dir.empty();
+        if(!plans_stored)
+        {
+            backend::export_fft_plans(cache_dir + "/fft_plans");
+            plans_stored = true;
+        }
     }
 }
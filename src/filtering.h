@@ -23,13 +23,22 @@
 #ifndef PARIS_FILTERING_H_
 #define PARIS_FILTERING_H_
 
+#include <string>
+#include <vector>
+
 #include "backend.h"
 #include "geometry.h"
 #include "projection.h"
 
 namespace paris
 {
-    auto filter(backend::projection_device_type& p, const detector_geometry& det_geo)
+    /**
+     * Weights and filters a batch of projections in place. The cosine weights are applied while padding the
+     * projections. If cache_path is not empty, FFT plans, filter kernel and weights are stored there and reused
+     * by later runs with the same geometry.
+     */
+    auto filter(std::vector<backend::projection_device_type>& p, const detector_geometry& det_geo,
+                const std::string& cache_path)
         noexcept(true && noexcept(backend::apply_filter))
         -> void;
 }
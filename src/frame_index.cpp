@@ -0,0 +1,188 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <locale>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+#include "frame_index.h"
+#include "his.h"
+#include "pack.h"
+
+namespace paris
+{
+    namespace
+    {
+        struct file_info
+        {
+            std::uint32_t frames = 0u;
+            std::vector<std::size_t> offsets;
+            std::exception_ptr error;
+        };
+
+        auto read_file_info(const std::string& path) -> file_info
+        {
+            auto info = file_info{};
+            try
+            {
+                // invalid files are reported by his::open()
+                auto h = his::open(path);
+                if(h == nullptr)
+                    return info;
+
+                info.frames = his::frame_count(*h);
+                info.offsets.reserve(info.frames);
+                for(auto f = 0u; f < info.frames; ++f)
+                    info.offsets.push_back(his::frame_offset(*h, f));
+            }
+            catch(...)
+            {
+                info.error = std::current_exception();
+            }
+            return info;
+        }
+    }
+
+    auto read_angles(const std::string& path) -> std::vector<float>
+    {
+        auto angles = std::vector<float>{};
+
+        auto&& file = std::ifstream{path.c_str()};
+        if(!file.is_open())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Could not open angle file at " << path << ", using default values.";
+            return angles;
+        }
+
+        auto angle_string = std::string{};
+        std::getline(file, angle_string);
+
+        auto loc = std::locale{};
+        if(angle_string.find(',') != std::string::npos)
+            loc = std::locale{"de_DE.UTF-8"};
+
+        file.seekg(0, std::ios_base::beg);
+        file.imbue(loc);
+
+        while(!file.eof())
+        {
+            auto angle = 0.f;
+            file >> angle;
+            angles.push_back(angle);
+        }
+
+        return angles;
+    }
+
+    auto make_frame_index(std::vector<std::string> paths, const std::vector<float>& angles) -> frame_index
+    {
+        auto infos = std::vector<file_info>(paths.size());
+
+        // opening files has a high latency on network file systems -> open several at once
+        const auto hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        const auto thread_num = std::min<std::size_t>(std::min(hw_threads, 16u), paths.size());
+
+        std::atomic<std::size_t> next{0u};
+        auto threads = std::vector<std::thread>{};
+        threads.reserve(thread_num);
+        for(auto t = 0u; t < thread_num; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                for(auto i = next++; i < paths.size(); i = next++)
+                    infos[i] = read_file_info(paths[i]);
+            });
+        }
+
+        for(auto&& t : threads)
+            t.join();
+
+        auto index = frame_index{};
+        index.has_angles = !angles.empty();
+        auto idx = 0u;
+        for(auto i = 0u; i < paths.size(); ++i)
+        {
+            auto& info = infos[i];
+            if(info.error != nullptr)
+                std::rethrow_exception(info.error);
+
+            for(auto f = 0u; f < info.frames; ++f, ++idx)
+            {
+                const auto phi = idx < angles.size() ? angles[idx] : 0.f;
+                index.frames.push_back(frame_entry{static_cast<std::uint32_t>(index.paths.size()), f,
+                                                   info.offsets[f], idx, phi});
+            }
+
+            if(info.frames != 0u)
+                index.paths.push_back(std::move(paths[i]));
+        }
+
+        if(!angles.empty() && angles.size() < index.frames.size())
+            BOOST_LOG_TRIVIAL(warning) << "The angle file contains only " << angles.size() << " angles for "
+                                       << index.frames.size() << " projections";
+
+        BOOST_LOG_TRIVIAL(info) << "Found " << index.frames.size() << " projections in " << index.paths.size()
+                                << " files";
+        return index;
+    }
+
+    auto make_frame_index(const std::string& path, const pack::handle& h, const std::vector<float>& angles)
+        -> frame_index
+    {
+        auto index = frame_index{};
+        index.packed = true;
+        index.has_angles = !angles.empty() || pack::has_angles(h);
+
+        const auto frames = pack::frame_count(h);
+        index.frames.reserve(frames);
+        for(auto f = 0u; f < frames; ++f)
+        {
+            const auto idx = pack::projection_index(h, f);
+
+            auto phi = 0.f;
+            if(!angles.empty())
+                phi = idx < angles.size() ? angles[idx] : 0.f;
+            else if(pack::has_angles(h))
+                phi = pack::angle(h, f);
+
+            index.frames.push_back(frame_entry{0u, f, pack::frame_offset(h, f), idx, phi});
+        }
+        index.paths.push_back(path);
+
+        if(!angles.empty() && angles.size() < index.frames.size())
+            BOOST_LOG_TRIVIAL(warning) << "The angle file contains only " << angles.size() << " angles for "
+                                       << index.frames.size() << " projections";
+
+        BOOST_LOG_TRIVIAL(info) << "Found " << index.frames.size() << " projections in " << path;
+        return index;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_FRAME_INDEX_H_
+#define PARIS_FRAME_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pack.h"
+
+namespace paris
+{
+    struct frame_entry
+    {
+        std::uint32_t file;     // position in frame_index::paths
+        std::uint32_t frame;    // frame number inside the file
+        std::size_t offset;     // byte offset of the frame's pixels inside the file
+        std::uint32_t idx;      // projection index
+        float phi;              // angle from the angle file or container index, 0 if there is none
+    };
+
+    struct frame_index
+    {
+        std::vector<std::string> paths;
+        std::vector<frame_entry> frames;
+        bool packed = false;        // paths holds a single projection container
+        bool has_angles = false;    // phi is valid for all frames
+    };
+
+    /**
+     * Reads one angle per projection from a text file. Returns an empty vector if the file cannot be opened.
+     */
+    auto read_angles(const std::string& path) -> std::vector<float>;
+
+    /**
+     * Parses the headers of all files in parallel and lists every projection in acquisition order. Invalid files
+     * are skipped. If angles is not empty, it is indexed by projection index.
+     */
+    auto make_frame_index(std::vector<std::string> paths, const std::vector<float>& angles) -> frame_index;
+
+    /**
+     * Lists the projections of a container created by paris.pack. Explicitly given angles take precedence over
+     * the angles stored in the container.
+     */
+    auto make_frame_index(const std::string& path, const pack::handle& h, const std::vector<float>& angles)
+        -> frame_index;
+}
+
+#endif /* PARIS_FRAME_INDEX_H_ */
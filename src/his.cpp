@@ -21,20 +21,18 @@
  */
 
 #include <algorithm>
-#include <cerrno>
 #include <cstddef>
 #include <cstdint>
-#include <fstream>
-#include <memory>
+#include <cstring>
 #include <string>
-#include <system_error>
 #include <utility>
-#include <vector>
 
 #include <boost/log/trivial.hpp>
 
 #include "backend.h"
+#include "convert.h"
 #include "his.h"
+#include "mapped_file.h"
 #include "projection.h"
 
 namespace paris
@@ -76,126 +74,195 @@ namespace paris
                 type_float              = 128
             };
 
+            // the mapping gives no alignment guarantees -> go through memcpy
             template <typename U>
-            auto read_entry(std::ifstream& file, U& entry) -> void
+            auto read_entry(const unsigned char*& pos, U& entry) noexcept -> void
             {
-                using char_type = typename std::ifstream::char_type;
-                file.read(reinterpret_cast<char_type*>(&entry), sizeof(entry));
+                std::memcpy(&entry, pos, sizeof(entry));
+                pos += sizeof(entry);
             }
 
-            template <typename U>
-            auto read_entry(std::ifstream& file, U* entry, std::streamsize size) -> void
+            auto read_header(const unsigned char* pos) noexcept -> his_header
             {
-                using char_type = typename std::ifstream::char_type;
-                file.read(reinterpret_cast<char_type*>(entry), size);
+                auto header = his_header{};
+                read_entry(pos, header.file_type);
+                read_entry(pos, header.header_size);
+                read_entry(pos, header.header_version);
+                read_entry(pos, header.file_size);
+                read_entry(pos, header.image_header_size);
+                read_entry(pos, header.ulx);
+                read_entry(pos, header.uly);
+                read_entry(pos, header.brx);
+                read_entry(pos, header.bry);
+                read_entry(pos, header.frame_number);
+                read_entry(pos, header.correction);
+                read_entry(pos, header.integration_time);
+                read_entry(pos, header.number_type);
+                read_entry(pos, header.x);
+                return header;
             }
 
-            template <typename T>
-            auto copy_to_buf(std::ifstream& file, float* dest, std::uint16_t w, std::uint16_t h) -> void
+            auto pixel_size(std::uint16_t number_type) noexcept -> std::size_t
             {
-                auto w_s = static_cast<std::size_t>(w);
-                auto h_s = static_cast<std::size_t>(h);
-                auto size = static_cast<std::streamsize>(w_s * h_s * sizeof(T));
-                auto buffer = std::unique_ptr<T[]>{new T[w_s * h_s]};
-                read_entry(file, buffer.get(), size);
-                std::copy(buffer.get(), buffer.get() + (w_s * h_s), dest);
+                switch(number_type)
+                {
+                    case static_cast<std::uint16_t>(data::type_uchar): return sizeof(std::uint8_t);
+                    case static_cast<std::uint16_t>(data::type_ushort): return sizeof(std::uint16_t);
+                    case static_cast<std::uint16_t>(data::type_dword): return sizeof(std::uint32_t);
+                    case static_cast<std::uint16_t>(data::type_double): return sizeof(double);
+                    case static_cast<std::uint16_t>(data::type_float): return sizeof(float);
+                    default: return 0u;
+                }
             }
         }
 
-        auto load(const std::string& path) -> std::vector<image_type>
+        struct handle
         {
-            auto vec = std::vector<image_type>{};
+            explicit handle(const std::string& path) : file{path} {}
 
-            auto header = his_header{};
+            mapped_file file;
+            his_header header;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::size_t frame_size;
+            std::uint32_t frames;
+        };
+
+        auto handle_deleter::operator()(handle* h) noexcept -> void
+        {
+            delete h;
+        }
 
-            auto&& file = std::ifstream{path.c_str(), std::ios_base::binary};
-            if(!file.is_open())
+        auto open(const std::string& path) -> handle_type
+        {
+            auto h = handle_type{new handle{path}};
+            const auto& file = h->file;
+            if(file.size() < static_cast<std::size_t>(file_header_size))
             {
-                BOOST_LOG_TRIVIAL(warning) << "his_loader::load() failed to open file at " << path;
-                throw std::system_error{errno, std::generic_category()};
+                BOOST_LOG_TRIVIAL(warning) << "his::open() could not open non-HIS file at " << path;
+                return handle_type{};
             }
 
-            read_entry(file, header.file_type);
-            read_entry(file, header.header_size);
-            read_entry(file, header.header_version);
-            read_entry(file, header.file_size);
-            read_entry(file, header.image_header_size);
-            read_entry(file, header.ulx);
-            read_entry(file, header.uly);
-            read_entry(file, header.brx);
-            read_entry(file, header.bry);
-            read_entry(file, header.frame_number);
-            read_entry(file, header.correction);
-            read_entry(file, header.integration_time);
-            read_entry(file, header.number_type);
-            read_entry(file, header.x);
+            h->header = read_header(file.data());
+            const auto& header = h->header;
 
             if(header.file_type != file_id)
             {
-                BOOST_LOG_TRIVIAL(warning) << "his_loader::load() could not open non-HIS file at " << path;
-                return vec;
+                BOOST_LOG_TRIVIAL(warning) << "his::open() could not open non-HIS file at " << path;
+                return handle_type{};
             }
             if(header.header_size != file_header_size)
             {
-                BOOST_LOG_TRIVIAL(warning) << "his_loader::load() encountered a file header size mismatch at " << path;
-                return vec;
+                BOOST_LOG_TRIVIAL(warning) << "his::open() encountered a file header size mismatch at " << path;
+                return handle_type{};
             }
-            if(header.number_type == static_cast<std::uint16_t>(data::type_not_implemented))
+
+            const auto px_size = pixel_size(header.number_type);
+            if(px_size == 0u)
             {
-                BOOST_LOG_TRIVIAL(warning) << "his_loader::load() encountered an unsupported data type at " << path;
-                return vec;
+                BOOST_LOG_TRIVIAL(warning) << "his::open() encountered an unsupported data type at " << path;
+                return handle_type{};
             }
 
             auto x1 = static_cast<std::uint32_t>(header.ulx);
             auto x2 = static_cast<std::uint32_t>(header.brx);
             auto y1 = static_cast<std::uint32_t>(header.uly);
             auto y2 = static_cast<std::uint32_t>(header.bry);
-            auto width = x2 - x1 + 1u;
-            auto height = y2 - y1 + 1u;
-            for(auto i = 0u; i < header.frame_number; ++i)
+            h->width = x2 - x1 + 1u;
+            h->height = y2 - y1 + 1u;
+
+            const auto pixels = static_cast<std::size_t>(h->width) * h->height;
+            h->frame_size = header.image_header_size + pixels * px_size;
+            if(pixels == 0u || h->frame_size == 0u)
             {
-                // skip image header
-                auto img_header = std::unique_ptr<std::uint8_t[]>{new std::uint8_t[header.image_header_size]};
-                read_entry(file, img_header.get(), header.image_header_size);
+                BOOST_LOG_TRIVIAL(warning) << "his::open() encountered an empty image size at " << path;
+                return handle_type{};
+            }
 
-                auto img = backend::make_projection_host(width, height);
+            // file.size() >= file_header_size was checked above
+            const auto complete = (file.size() - file_header_size) / h->frame_size;
+            h->frames = header.frame_number;
+            if(complete < header.frame_number)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "his::open() encountered a truncated file at " << path;
+                h->frames = static_cast<std::uint32_t>(complete);
+            }
 
-                auto w16 = static_cast<std::uint16_t>(width);
-                auto h16 = static_cast<std::uint16_t>(height);
-                using num_type = decltype(header.number_type);
-                switch(header.number_type)
-                {
-                    case static_cast<num_type>(data::type_uchar):
-                        copy_to_buf<std::uint8_t>(file, img.buf.get(), w16, h16);
-                        break;
+            return h;
+        }
 
-                    case static_cast<num_type>(data::type_ushort):
-                        copy_to_buf<std::uint16_t>(file, img.buf.get(), w16, h16);
-                        break;
+        auto frame_count(const handle& h) noexcept -> std::uint32_t
+        {
+            return h.frames;
+        }
 
-                    case static_cast<num_type>(data::type_dword):
-                        copy_to_buf<std::uint32_t>(file, img.buf.get(), w16, h16);
-                        break;
+        auto width(const handle& h) noexcept -> std::uint32_t
+        {
+            return h.width;
+        }
 
-                    case static_cast<num_type>(data::type_double):
-                        copy_to_buf<double>(file, img.buf.get(), w16, h16);
-                        break;
+        auto height(const handle& h) noexcept -> std::uint32_t
+        {
+            return h.height;
+        }
 
-                    case static_cast<num_type>(data::type_float):
-                        copy_to_buf<float>(file, img.buf.get(), w16, h16);
-                        break;
+        auto fits_uint16(const handle& h) noexcept -> bool
+        {
+            return h.header.number_type == static_cast<std::uint16_t>(data::type_uchar)
+                   || h.header.number_type == static_cast<std::uint16_t>(data::type_ushort);
+        }
 
-                    default:
-                        BOOST_LOG_TRIVIAL(warning) << "his_loader::load() tried to load an unsupported data type.";
-                        return vec;
-                }
+        auto frame_offset(const handle& h, std::uint32_t frame) noexcept -> std::size_t
+        {
+            return file_header_size + frame * h.frame_size + h.header.image_header_size;
+        }
+
+        auto prefetch(const handle& h, std::uint32_t first, std::uint32_t num) noexcept -> void
+        {
+            if(first >= h.frames)
+                return;
+
+            num = std::min(num, h.frames - first);
+            h.file.prefetch(file_header_size + first * h.frame_size, num * h.frame_size);
+        }
+
+        auto read_frame(const handle& h, std::uint32_t frame) -> image_type
+        {
+            const auto pixels = static_cast<std::size_t>(h.width) * h.height;
 
-                img.dim_x = static_cast<std::uint32_t>(width);
-                img.dim_y = static_cast<std::uint32_t>(height);
-                vec.push_back(std::move(img));
+            const auto src = h.file.data() + frame_offset(h, frame);
+
+            auto img = backend::make_projection_host(h.width, h.height);
+
+            switch(h.header.number_type)
+            {
+                case static_cast<std::uint16_t>(data::type_uchar):
+                    convert_u8(src, img.buf.get(), pixels);
+                    break;
+
+                case static_cast<std::uint16_t>(data::type_ushort):
+                    convert_u16(src, img.buf.get(), pixels);
+                    break;
+
+                case static_cast<std::uint16_t>(data::type_dword):
+                    convert<std::uint32_t>(src, img.buf.get(), pixels);
+                    break;
+
+                case static_cast<std::uint16_t>(data::type_double):
+                    convert<double>(src, img.buf.get(), pixels);
+                    break;
+
+                case static_cast<std::uint16_t>(data::type_float):
+                    std::memcpy(img.buf.get(), src, pixels * sizeof(float));
+                    break;
+
+                default:
+                    break;
             }
-            return vec;
+
+            img.dim_x = h.width;
+            img.dim_y = h.height;
+            return img;
         }
     }
 }
-
@@ -23,9 +23,11 @@
 #ifndef PARIS_HIS_LOADER_H_
 #define PARIS_HIS_LOADER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
-#include <vector>
 
 #include "backend.h"
 #include "projection.h"
@@ -35,7 +37,34 @@ namespace paris
     namespace his
     {
         using image_type = backend::projection_host_type;
-        auto load(const std::string& path) -> std::vector<image_type>;
+
+        struct handle;
+        struct handle_deleter { auto operator()(handle* h) noexcept -> void; };
+        using handle_type = std::unique_ptr<handle, handle_deleter>;
+
+        /**
+         * Maps the file and parses its header. Returns an empty handle if the file is not a valid HIS file.
+         */
+        auto open(const std::string& path) -> handle_type;
+
+        // number of complete frames in the file
+        auto frame_count(const handle& h) noexcept -> std::uint32_t;
+
+        // frame dimensions in pixels
+        auto width(const handle& h) noexcept -> std::uint32_t;
+        auto height(const handle& h) noexcept -> std::uint32_t;
+
+        // true if all pixel values are representable as uint16 without loss (8 and 16 bit files)
+        auto fits_uint16(const handle& h) noexcept -> bool;
+
+        // byte offset of the frame's pixels inside the file
+        auto frame_offset(const handle& h, std::uint32_t frame) noexcept -> std::size_t;
+
+        // hints the kernel to read the given frames in the background
+        auto prefetch(const handle& h, std::uint32_t first, std::uint32_t num) noexcept -> void;
+
+        // decodes a single frame, frames can be read in any order and from several threads
+        auto read_frame(const handle& h, std::uint32_t frame) -> image_type;
     }
 }
 
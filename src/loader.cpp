@@ -31,4 +31,11 @@ namespace paris
         backend::copy_h2d(p, d_p);
         return d_p;
     }
+
+    auto unload(const backend::projection_device_type& p) -> backend::projection_host_type
+    {
+        auto h_p = backend::make_projection_host(p.dim_x, p.dim_y);
+        backend::copy_d2h(p, h_p);
+        return h_p;
+    }
 }
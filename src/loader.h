@@ -29,6 +29,7 @@
 namespace paris
 {
     auto load(const backend::projection_host_type& p) -> backend::projection_device_type;
+    auto unload(const backend::projection_device_type& p) -> backend::projection_host_type;
 }
 
 #endif /* PARIS_LOADER_H_ */
@@ -30,6 +30,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <execinfo.h>
@@ -43,17 +44,15 @@
 #include "backend.h"
 #include "backprojection.h"
 #include "exception.h"
-#include "filtering.h"
 #include "geometry.h"
 #include "loader.h"
 #include "make_volume.h"
 #include "program_options.h"
+#include "projection_stream.h"
 #include "sink.h"
-#include "source.h"
 #include "subvolume_information.h"
 #include "task.h"
 #include "version.h"
-#include "weighting.h"
 
 namespace
 {
@@ -79,32 +78,50 @@ namespace
     auto reconstruct(glados::pipeline::task_queue<paris::task>* queue,
                      std::size_t task_num,
                      paris::backend::device_handle& device,
-                     paris::sink& sink) -> void
+                     paris::projection_stream& stream,
+                     paris::sink& sink,
+                     std::uint16_t filter_threads) -> void
     {
         if(queue == nullptr)
             return;
 
         paris::backend::set_device(device);
 
+        // leave the filtering threads their cores
+        if(stream.filtering())
+            paris::backend::use_backprojection_threads(filter_threads);
+
         while(!queue->empty())
         {
             auto t = queue->pop();
             auto last = (task_num - t.id) > 1 ? false : true;
-            auto source = paris::source(t.input_path, t.enable_angles, t.angle_path, t.quality);
+            BOOST_LOG_TRIVIAL(info) << "Subvolume #" << t.id << ": backprojecting " << stream.size()
+                                    << " projections";
+            const auto enable_angles = t.enable_angles || stream.has_angles();
 
-            auto v = paris::make_volume(t.subvol_geo, last);
+            auto v = sink.make_volume(t.subvol_geo, last);
             auto offset = t.id * t.subvol_geo.dim_z;
+            v.off = offset;
+
+            // the stream delivers preprocessed projections, they are backprojected in batches
+            auto batch = std::vector<paris::backend::projection_device_type>{};
+            batch.reserve(t.batch_size);
 
-            while(!source.drained())
+            for(auto n = std::size_t{0}; n < stream.size(); ++n)
             {
-                auto p = source.load_next();
-                auto d_p = paris::load(p);
-                paris::weight(d_p, t.det_geo);
-                paris::filter(d_p, t.det_geo);
-                paris::backproject(d_p, v, offset, t.det_geo, t.vol_geo, t.enable_angles, t.enable_roi, t.roi); 
+                auto p = stream.get(n);
+                batch.push_back(paris::load(*p));
+
+                if(batch.size() == t.batch_size || n + 1u == stream.size())
+                {
+                    paris::backproject(batch, v, offset, t.det_geo, t.vol_geo, enable_angles, t.enable_roi, t.roi,
+                                       t.skip_invisible);
+                    batch.clear();
+                }
             }
 
-            sink.save(v);
+            // the sink writes in the background, the next subvolume can start right away
+            sink.save(std::move(v));
         }
     }
 }
@@ -134,7 +151,7 @@ auto main(int argc, char** argv) -> int
             auto start = std::chrono::high_resolution_clock::now();
 
             // split the volume into subvolumes
-            auto subvol_info = paris::backend::make_subvolume_information(roi_geo, po.det_geo);
+            auto subvol_info = paris::backend::make_subvolume_information(roi_geo, po);
 
             // generate tasks
             auto tasks = paris::make_tasks(po, vol_geo, subvol_info);
@@ -152,21 +169,28 @@ auto main(int argc, char** argv) -> int
             BOOST_LOG_TRIVIAL(info) << "Created " << tasks.size() << " " << task_string << " for " << devices.size() << ' ' << device_string;
 
             // create sink
-            auto sink = paris::sink{po.output_path, po.prefix, roi_geo};
+            auto&& sink = paris::sink{po, roi_geo, subvol_info.num};
+
+            // projections are read and preprocessed once for all subvolumes
+            auto&& stream = paris::projection_stream{po, static_cast<std::uint32_t>(task_num),
+                                                     subvol_info.projection_cache, devices[0]};
 
             if(devices.size() > 1)
             {
                 // launch a reconstruction thread for each available device
                 for(auto&& d : devices)
                     futures.emplace_back(std::async(std::launch::async, reconstruct, &task_queue, task_num,
-                                                                        std::ref(d), std::ref(sink)));
+                                                                        std::ref(d), std::ref(stream),
+                                                                        std::ref(sink), po.filter_threads));
 
                 // wait for the end of execution
                 for(auto&& f : futures)
                     f.get();
             }
             else
-                reconstruct(&task_queue, task_num, devices[0], sink);
+                reconstruct(&task_queue, task_num, devices[0], stream, sink, po.filter_threads);
+
+            sink.flush();
 
             auto stop = std::chrono::high_resolution_clock::now();
 
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+namespace paris
+{
+    mapped_file::mapped_file(const std::string& path, bool sequential)
+    {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if(fd_ == -1)
+            throw std::system_error{errno, std::generic_category()};
+
+        struct stat st;
+        if(::fstat(fd_, &st) == -1)
+        {
+            auto err = errno;
+            ::close(fd_);
+            throw std::system_error{err, std::generic_category()};
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        if(size_ == 0u)
+            return;
+
+        auto addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if(addr == MAP_FAILED)
+        {
+            auto err = errno;
+            ::close(fd_);
+            throw std::system_error{err, std::generic_category()};
+        }
+
+        if(sequential)
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const unsigned char*>(addr);
+    }
+
+    mapped_file::~mapped_file()
+    {
+        if(data_ != nullptr)
+            ::munmap(const_cast<unsigned char*>(data_), size_);
+        ::close(fd_);
+    }
+
+    auto mapped_file::prefetch(std::size_t offset, std::size_t length) const noexcept -> void
+    {
+        if(offset >= size_)
+            return;
+
+        length = std::min(length, size_ - offset);
+
+        // madvise() needs a page-aligned start address
+        static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const auto aligned = offset - offset % page_size;
+
+        ::madvise(const_cast<unsigned char*>(data_) + aligned, offset - aligned + length, MADV_WILLNEED);
+    }
+}
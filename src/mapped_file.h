@@ -0,0 +1,57 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_MAPPED_FILE_H_
+#define PARIS_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace paris
+{
+    /**
+     * Read-only mapping of a whole file. Throws std::system_error if the file cannot be opened or mapped. Files that
+     * are not read front to back should disable the sequential read-ahead hint.
+     */
+    class mapped_file
+    {
+        public:
+            explicit mapped_file(const std::string& path, bool sequential = true);
+            ~mapped_file();
+
+            mapped_file(const mapped_file&) = delete;
+            auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+            auto data() const noexcept -> const unsigned char* { return data_; }
+            auto size() const noexcept -> std::size_t { return size_; }
+
+            // hints the kernel to read [offset, offset + length) in the background
+            auto prefetch(std::size_t offset, std::size_t length) const noexcept -> void;
+
+        private:
+            int fd_ = -1;
+            const unsigned char* data_ = nullptr;
+            std::size_t size_ = 0u;
+    };
+}
+
+#endif /* PARIS_MAPPED_FILE_H_ */
@@ -23,13 +23,16 @@
 #ifndef PARIS_OPENMP_BACKEND_H_
 #define PARIS_OPENMP_BACKEND_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <fftw3.h>
 
 #include "../geometry.h"
+#include "../program_options.h"
 #include "../projection.h"
 #include "../region_of_interest.h"
 #include "../subvolume_information.h"
@@ -63,23 +66,26 @@ namespace paris
         auto copy_h2d(const volume_host_type& h_v, volume_device_type& d_v) noexcept -> void;
         auto copy_d2h(const volume_device_type& d_v, volume_host_type& h_v) noexcept -> void;
 
-        auto make_subvolume_information(const volume_geometry& vol_geo, const detector_geometry& det_geo) noexcept
-            -> subvolume_info;
+        auto make_subvolume_information(const volume_geometry& vol_geo, const program_options& po) -> subvolume_info;
 
-        auto weight(projection_device_type& p, float h_min, float v_min, float d_sd, float l_px_row, float l_px_col)
-            noexcept
-            -> void;
+        using weight_buffer_type = std::unique_ptr<float[]>;
+        auto make_weights(std::uint32_t n_row, std::uint32_t n_col, float h_min, float v_min, float d_sd,
+                          float l_px_row, float l_px_col, const std::string& cache_file) -> weight_buffer_type;
 
         struct fftw_deleter { auto operator()(void* p) noexcept -> void; };
-        using filter_buffer_type = std::unique_ptr<fftwf_complex[], fftw_deleter>;
-        auto make_filter(std::uint32_t size, float tau) -> filter_buffer_type;
-        auto apply_filter(projection_device_type& p, const filter_buffer_type& k, std::uint32_t filter_size,
-                          std::uint32_t n_col) -> void;
+        using filter_buffer_type = std::unique_ptr<float[], fftw_deleter>;
+        auto make_filter(std::uint32_t size, float tau, const std::string& cache_file) -> filter_buffer_type;
+        auto apply_filter(std::vector<projection_device_type>& p, const filter_buffer_type& k,
+                          const weight_buffer_type& w, std::uint32_t filter_size, std::uint32_t n_col) -> void;
 
-        auto backproject(const projection_device_type& p, volume_device_type& v, std::uint32_t v_offset,
-                         const detector_geometry& det_geo, const volume_geometry& vol_geo, 
-                         bool enable_roi, const region_of_interest& roi, float sin, float cos,
-                         float delta_s, float delta_t) noexcept -> void;
+        auto import_fft_plans(const std::string& path) -> bool;
+        auto export_fft_plans(const std::string& path) -> void;
+
+        auto backproject(const std::vector<projection_device_type>& p, volume_device_type& v, std::uint32_t v_offset,
+                         const detector_geometry& det_geo, const volume_geometry& vol_geo,
+                         bool enable_roi, const region_of_interest& roi,
+                         const std::vector<float>& sin, const std::vector<float>& cos,
+                         float delta_s, float delta_t, bool skip_invisible) noexcept -> void;
 
         /**
          * Device management
@@ -87,6 +93,12 @@ namespace paris
         using device_handle = int;
         inline auto get_devices() -> std::vector<device_handle> { return std::vector<device_handle>{0}; }
         constexpr auto set_device(device_handle&) noexcept -> int { return 0; }
+
+        /* The projection stream filters on its own thread while the subvolumes are backprojected, both start OpenMP
+         * teams. The cores are split between them: filter_threads for filtering (0 -> a quarter of the cores), the
+         * rest for backprojection. Applies to the parallel regions started by the calling thread. */
+        auto use_filter_threads(std::uint16_t filter_threads) -> void;
+        auto use_backprojection_threads(std::uint16_t filter_threads) -> void;
     }
 }
 
@@ -20,12 +20,26 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
 
 #include <boost/log/trivial.hpp>
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PARIS_OPENMP_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define PARIS_OPENMP_X86_SIMD 0
+#endif
+
 #include "../region_of_interest.h"
 
 #include "backend.h"
@@ -52,100 +66,451 @@ namespace paris
             auto interpolate(const float* p, float x, float y, std::uint32_t dim_x, std::uint32_t dim_y) noexcept
                 -> float
             {
-                auto x1 = std::floor(x);
-                auto x2 = x1 + 1.f;
-                auto y1 = std::floor(y);
-                auto y2 = y1 + 1.f;
-
-                auto x1u = static_cast<std::uint32_t>(x1);
-                auto x2u = static_cast<std::uint32_t>(x2);
-                auto y1u = static_cast<std::uint32_t>(y1);
-                auto y2u = static_cast<std::uint32_t>(y2);
-
-                auto x1_valid = x1 >= 0.f;
-                auto x2_valid = x2 < static_cast<float>(dim_x);
-                auto y1_valid = y1 >= 0.f;
-                auto y2_valid = y2 < static_cast<float>(dim_y);
-
-                auto interp = 0.f;
-                if(x1_valid && x2_valid && y1_valid && y2_valid)
+                const auto x1 = std::floor(x);
+                const auto y1 = std::floor(y);
+
+                // all four neighbours have to be located on the detector
+                const auto valid = (x1 >= 0.f) && (x1 + 1.f < static_cast<float>(dim_x)) &&
+                                   (y1 >= 0.f) && (y1 + 1.f < static_cast<float>(dim_y));
+                if(!valid)
+                    return 0.f;
+
+                const auto idx = static_cast<std::size_t>(x1) + static_cast<std::size_t>(y1) * dim_x;
+                const auto q11 = p[idx];
+                const auto q21 = p[idx + 1];
+                const auto q12 = p[idx + dim_x];
+                const auto q22 = p[idx + dim_x + 1];
+
+                // neighbouring pixels are exactly one unit apart -> the weights are simply the fractional parts
+                const auto dx = x - x1;
+                const auto dy = y - y1;
+                const auto interp_y1 = q11 + dx * (q21 - q11);
+                const auto interp_y2 = q12 + dx * (q22 - q12);
+
+                return interp_y1 + dy * (interp_y2 - interp_y1);
+            }
+
+            /* Backprojects one projection onto one volume row. h, v_scale and w hold the precomputed column values
+             * for this row, the vertical detector coordinate is v = z_m * v_scale + v_0. */
+            using row_kernel = void (*)(float* row, const float* p, const float* h, const float* v_scale,
+                                        const float* w, float z_m, float v_0, std::uint32_t n,
+                                        std::uint32_t p_dim_x, std::uint32_t p_dim_y);
+
+            auto backproject_row(float* row, const float* p, const float* h, const float* v_scale, const float* w,
+                                 float z_m, float v_0, std::uint32_t n,
+                                 std::uint32_t p_dim_x, std::uint32_t p_dim_y) noexcept -> void
+            {
+                for(auto k = 0u; k < n; ++k)
+                {
+                    const auto v = z_m * v_scale[k] + v_0;
+
+                    // get projection value through interpolation
+                    const auto det = interpolate(p, h[k], v, p_dim_x, p_dim_y);
+
+                    // backproject
+                    row[k] += det * w[k];
+                }
+            }
+
+#if PARIS_OPENMP_X86_SIMD
+            /* The remaining voxels of the AVX2 kernel. Uses the same fused multiply-adds as the vector lanes so a
+             * voxel's result does not depend on its position in the row. */
+            __attribute__((target("avx2,fma")))
+            auto backproject_row_fma(float* row, const float* p, const float* h, const float* v_scale, const float* w,
+                                     float z_m, float v_0, std::uint32_t n,
+                                     std::uint32_t p_dim_x, std::uint32_t p_dim_y) noexcept -> void
+            {
+                for(auto k = 0u; k < n; ++k)
+                {
+                    const auto x = h[k];
+                    const auto y = std::fma(z_m, v_scale[k], v_0);
+
+                    const auto x1 = std::floor(x);
+                    const auto y1 = std::floor(y);
+
+                    const auto valid = (x1 >= 0.f) && (x1 + 1.f < static_cast<float>(p_dim_x)) &&
+                                       (y1 >= 0.f) && (y1 + 1.f < static_cast<float>(p_dim_y));
+                    if(!valid)
+                        continue;
+
+                    const auto idx = static_cast<std::size_t>(x1) + static_cast<std::size_t>(y1) * p_dim_x;
+                    const auto q11 = p[idx];
+                    const auto q21 = p[idx + 1];
+                    const auto q12 = p[idx + p_dim_x];
+                    const auto q22 = p[idx + p_dim_x + 1];
+
+                    const auto dx = x - x1;
+                    const auto dy = y - y1;
+                    const auto interp_y1 = std::fma(dx, q21 - q11, q11);
+                    const auto interp_y2 = std::fma(dx, q22 - q12, q12);
+                    const auto det = std::fma(dy, interp_y2 - interp_y1, interp_y1);
+
+                    row[k] = std::fma(det, w[k], row[k]);
+                }
+            }
+
+            __attribute__((target("avx2,fma")))
+            auto backproject_row_avx2(float* row, const float* p, const float* h, const float* v_scale, const float* w,
+                                      float z_m, float v_0, std::uint32_t n,
+                                      std::uint32_t p_dim_x, std::uint32_t p_dim_y) noexcept -> void
+            {
+                const auto z = _mm256_set1_ps(z_m);
+                const auto v0 = _mm256_set1_ps(v_0);
+                const auto zero = _mm256_setzero_ps();
+                const auto one = _mm256_set1_ps(1.f);
+                const auto dim_x = _mm256_set1_ps(static_cast<float>(p_dim_x));
+                const auto dim_y = _mm256_set1_ps(static_cast<float>(p_dim_y));
+                const auto pitch = _mm256_set1_epi32(static_cast<int>(p_dim_x));
+
+                const auto p_below = p + p_dim_x;
+
+                auto k = 0u;
+                for(; k + 8u <= n; k += 8u)
+                {
+                    const auto x = _mm256_loadu_ps(h + k);
+                    const auto y = _mm256_fmadd_ps(z, _mm256_loadu_ps(v_scale + k), v0);
+
+                    const auto x1 = _mm256_floor_ps(x);
+                    const auto y1 = _mm256_floor_ps(y);
+
+                    // lanes whose neighbours are not located on the detector are masked out of the gathers
+                    auto valid = _mm256_and_ps(_mm256_cmp_ps(x1, zero, _CMP_GE_OQ),
+                                               _mm256_cmp_ps(_mm256_add_ps(x1, one), dim_x, _CMP_LT_OQ));
+                    valid = _mm256_and_ps(valid, _mm256_cmp_ps(y1, zero, _CMP_GE_OQ));
+                    valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_add_ps(y1, one), dim_y, _CMP_LT_OQ));
+
+                    const auto idx = _mm256_add_epi32(_mm256_cvttps_epi32(x1),
+                                                      _mm256_mullo_epi32(_mm256_cvttps_epi32(y1), pitch));
+
+                    const auto q11 = _mm256_mask_i32gather_ps(zero, p, idx, valid, 4);
+                    const auto q21 = _mm256_mask_i32gather_ps(zero, p + 1, idx, valid, 4);
+                    const auto q12 = _mm256_mask_i32gather_ps(zero, p_below, idx, valid, 4);
+                    const auto q22 = _mm256_mask_i32gather_ps(zero, p_below + 1, idx, valid, 4);
+
+                    const auto dx = _mm256_sub_ps(x, x1);
+                    const auto dy = _mm256_sub_ps(y, y1);
+                    const auto interp_y1 = _mm256_fmadd_ps(dx, _mm256_sub_ps(q21, q11), q11);
+                    const auto interp_y2 = _mm256_fmadd_ps(dx, _mm256_sub_ps(q22, q12), q12);
+                    const auto det = _mm256_fmadd_ps(dy, _mm256_sub_ps(interp_y2, interp_y1), interp_y1);
+
+                    _mm256_storeu_ps(row + k, _mm256_fmadd_ps(det, _mm256_loadu_ps(w + k), _mm256_loadu_ps(row + k)));
+                }
+
+                // remaining voxels
+                backproject_row_fma(row + k, p, h + k, v_scale + k, w + k, z_m, v_0, n - k, p_dim_x, p_dim_y);
+            }
+
+            __attribute__((target("avx512f")))
+            auto backproject_row_avx512(float* row, const float* p, const float* h, const float* v_scale,
+                                        const float* w, float z_m, float v_0, std::uint32_t n,
+                                        std::uint32_t p_dim_x, std::uint32_t p_dim_y) noexcept -> void
+            {
+                const auto z = _mm512_set1_ps(z_m);
+                const auto v0 = _mm512_set1_ps(v_0);
+                const auto zero = _mm512_setzero_ps();
+                const auto one = _mm512_set1_ps(1.f);
+                const auto dim_x = _mm512_set1_ps(static_cast<float>(p_dim_x));
+                const auto dim_y = _mm512_set1_ps(static_cast<float>(p_dim_y));
+                const auto pitch = _mm512_set1_epi32(static_cast<int>(p_dim_x));
+
+                const auto p_below = p + p_dim_x;
+
+                for(auto k = 0u; k < n; k += 16u)
+                {
+                    // the last iteration only covers the remaining voxels
+                    const auto rest = n - k;
+                    const auto lanes = static_cast<__mmask16>(rest >= 16u ? 0xFFFFu : (1u << rest) - 1u);
+
+                    const auto x = _mm512_maskz_loadu_ps(lanes, h + k);
+                    const auto y = _mm512_fmadd_ps(z, _mm512_maskz_loadu_ps(lanes, v_scale + k), v0);
+
+                    const auto x1 = _mm512_maskz_roundscale_ps(lanes, x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+                    const auto y1 = _mm512_maskz_roundscale_ps(lanes, y, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+                    // lanes whose neighbours are not located on the detector are masked out of the gathers
+                    auto valid = _mm512_mask_cmp_ps_mask(lanes, x1, zero, _CMP_GE_OQ);
+                    valid = _mm512_mask_cmp_ps_mask(valid, _mm512_add_ps(x1, one), dim_x, _CMP_LT_OQ);
+                    valid = _mm512_mask_cmp_ps_mask(valid, y1, zero, _CMP_GE_OQ);
+                    valid = _mm512_mask_cmp_ps_mask(valid, _mm512_add_ps(y1, one), dim_y, _CMP_LT_OQ);
+
+                    const auto idx = _mm512_add_epi32(_mm512_maskz_cvttps_epi32(valid, x1),
+                                                      _mm512_mullo_epi32(_mm512_maskz_cvttps_epi32(valid, y1), pitch));
+
+                    const auto q11 = _mm512_mask_i32gather_ps(zero, valid, idx, p, 4);
+                    const auto q21 = _mm512_mask_i32gather_ps(zero, valid, idx, p + 1, 4);
+                    const auto q12 = _mm512_mask_i32gather_ps(zero, valid, idx, p_below, 4);
+                    const auto q22 = _mm512_mask_i32gather_ps(zero, valid, idx, p_below + 1, 4);
+
+                    const auto dx = _mm512_sub_ps(x, x1);
+                    const auto dy = _mm512_sub_ps(y, y1);
+                    const auto interp_y1 = _mm512_fmadd_ps(dx, _mm512_sub_ps(q21, q11), q11);
+                    const auto interp_y2 = _mm512_fmadd_ps(dx, _mm512_sub_ps(q22, q12), q12);
+                    const auto det = _mm512_fmadd_ps(dy, _mm512_sub_ps(interp_y2, interp_y1), interp_y1);
+
+                    const auto old = _mm512_maskz_loadu_ps(lanes, row + k);
+                    _mm512_mask_storeu_ps(row + k, lanes,
+                                          _mm512_fmadd_ps(det, _mm512_maskz_loadu_ps(lanes, w + k), old));
+                }
+            }
+#endif
+
+            auto select_row_kernel() noexcept -> row_kernel
+            {
+#if PARIS_OPENMP_X86_SIMD
+                __builtin_cpu_init();
+                if(__builtin_cpu_supports("avx512f"))
                 {
-                    auto q11 = p[x1u + y1u * dim_x];
-                    auto q12 = p[x1u + y2u * dim_x];
-                    auto q21 = p[x2u + y1u * dim_x];
-                    auto q22 = p[x2u + y2u * dim_x];
-                    auto interp_y1 = (x2 - x) / (x2 - x1) * q11 + (x - x1) / (x2 - x1) * q21;
-                    auto interp_y2 = (x2 - x) / (x2 - x1) * q12 + (x - x1) / (x2 - x1) * q22;
-
-                    interp = (y2 - y) / (y2 - y1) * interp_y1 + (y - y1) / (y2 - y1) * interp_y2;
+                    BOOST_LOG_TRIVIAL(info) << "Using AVX-512 backprojection kernel";
+                    return backproject_row_avx512;
                 }
 
-                return interp;
+                if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                {
+                    BOOST_LOG_TRIVIAL(info) << "Using AVX2 backprojection kernel";
+                    return backproject_row_avx2;
+                }
+#endif
+                BOOST_LOG_TRIVIAL(info) << "Using scalar backprojection kernel";
+                return backproject_row;
+            }
+
+            // per-core L2 cache size -- fall back to a conservative guess if the OS does not know
+            auto l2_cache_size() noexcept -> std::size_t
+            {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+                const auto size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+                if(size > 0)
+                    return static_cast<std::size_t>(size);
+#endif
+                return 256u * 1024u;
+            }
+
+            /* Choose the edge length of the (tile x tile x dim_z) bricks the volume is split into. Each thread
+             * keeps the column values of its brick and the detector area the brick projects to while walking
+             * along z. Both should fit into L2 together with some space left for the volume rows. */
+            auto make_tile_size(std::uint32_t p_num, float px_per_vx_h, float px_per_vx_v) noexcept -> std::uint32_t
+            {
+                static const auto l2_budget = l2_cache_size() / 2u;
+
+                constexpr auto tile_max = 128u;
+                constexpr auto tile_min = 16u;
+                for(auto tile = tile_max; tile > tile_min; tile -= tile_min)
+                {
+                    const auto tile_f = static_cast<float>(tile);
+
+                    // h, v_scale and w for every column
+                    const auto columns = 3u * tile * tile * sizeof(float);
+
+                    // detector area touched by one slice of the brick and the next
+                    const auto fp_w = static_cast<std::size_t>(std::ceil(tile_f * px_per_vx_h)) + 2u;
+                    const auto fp_h = static_cast<std::size_t>(std::ceil(2.f * px_per_vx_v)) + 2u;
+                    const auto footprint = fp_w * fp_h * sizeof(float);
+
+                    if(p_num * (columns + footprint) <= l2_budget)
+                        return tile;
+                }
+                return tile_min;
+            }
+
+            /* Voxel range [first, last) of a brick row whose x coordinates satisfy -x_r <= x_k <= x_r. k_first is the
+             * global index of the brick's first voxel, x_0 the x coordinate of the global voxel 0. */
+            inline auto inner_range(float x_r, float x_0, float l_vx_x, std::int64_t k_first,
+                                    std::uint32_t k_num) noexcept -> std::pair<std::uint32_t, std::uint32_t>
+            {
+                const auto k_num_i = static_cast<std::int64_t>(k_num);
+                auto first = static_cast<std::int64_t>(std::ceil((-x_r - x_0) / l_vx_x)) - k_first;
+                auto last = static_cast<std::int64_t>(std::floor((x_r - x_0) / l_vx_x)) + 1 - k_first;
+
+                first = std::min(std::max(first, std::int64_t{0}), k_num_i);
+                last = std::min(std::max(last, first), k_num_i);
+                return std::make_pair(static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(last));
+            }
+
+            // same as above, but for the open interval -x_r < x_k < x_r
+            inline auto inner_range_open(float x_r, float x_0, float l_vx_x, std::int64_t k_first,
+                                         std::uint32_t k_num) noexcept -> std::pair<std::uint32_t, std::uint32_t>
+            {
+                const auto k_num_i = static_cast<std::int64_t>(k_num);
+                auto first = static_cast<std::int64_t>(std::floor((-x_r - x_0) / l_vx_x)) + 1 - k_first;
+                auto last = static_cast<std::int64_t>(std::ceil((x_r - x_0) / l_vx_x)) - k_first;
+
+                first = std::min(std::max(first, std::int64_t{0}), k_num_i);
+                last = std::min(std::max(last, first), k_num_i);
+                return std::make_pair(static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(last));
             }
 
             template <bool enable_roi>
             auto do_backprojection(float* vol_ptr, std::uint32_t v_dim_x, std::uint32_t v_dim_y, std::uint32_t v_dim_z,
-                                   const float* p_ptr, std::uint32_t p_dim_x, std::uint32_t p_dim_y,
+                                   const float* const* p_ptrs, std::uint32_t p_dim_x, std::uint32_t p_dim_y,
+                                   std::uint32_t p_num,
                                    std::uint32_t offset,
                                    std::uint32_t v_dim_x_full, std::uint32_t v_dim_y_full, std::uint32_t v_dim_z_full,
                                    float l_vx_x, float l_vx_y, float l_vx_z,
                                    float l_px_x, float l_px_y, float d_so, float d_sd, float delta_s, float delta_t,
-                                   float sin, float cos, const region_of_interest& roi) noexcept -> void
+                                   const float* sins, const float* coss, const region_of_interest& roi,
+                                   bool skip_invisible, std::uint32_t tile, row_kernel kernel) noexcept -> void
             {
-                #pragma omp parallel for collapse(3)
-                for(auto m = 0u; m < v_dim_z; ++m)
+                const auto slice_size = static_cast<std::size_t>(v_dim_x) * static_cast<std::size_t>(v_dim_y);
+                const auto tile_area = static_cast<std::size_t>(tile) * static_cast<std::size_t>(tile);
+                const auto tile_batch_size = tile_area * static_cast<std::size_t>(p_num);
+
+                const auto tiles_x = (v_dim_x + tile - 1u) / tile;
+                const auto tiles_y = (v_dim_y + tile - 1u) / tile;
+
+                // v = z_m * factor / l_px_y + v_0 -- v_0 does not depend on the voxel
+                const auto v_0 = proj_real_coordinate(0.f, p_dim_y, l_px_y, delta_t);
+
+                // x coordinate of the first voxel of a full row
+                const auto x_0 = vol_centered_coordinate(0u, v_dim_x_full, l_vx_x);
+
+                /* Only voxels inside the cylinder inscribed into the volume are covered by the detector for all
+                 * angles. Everything outside is not reconstructable and skipped. */
+                const auto r_fov = std::min(static_cast<float>(v_dim_x_full) * l_vx_x,
+                                            static_cast<float>(v_dim_y_full) * l_vx_y) / 2.f;
+
+                /* A voxel at radius rho and height z is projected onto z * d_sd / (d_so + s) with s in [-rho, rho].
+                 * Close to the rotation axis the vertical magnification is too large for voxels far above or below
+                 * the central slice -- if z * d_sd / (d_so + rho) misses the valid detector rows, the voxel is
+                 * never hit by any projection. This gives a minimal radius for each slice. The margin keeps the
+                 * test conservative. */
+                const auto c_min = -(static_cast<float>(p_dim_y) * l_px_y / 2.f) - delta_t;
+                const auto c_lo = c_min + l_px_y / 2.f;
+                const auto c_hi = c_min + (static_cast<float>(p_dim_y) - 0.5f) * l_px_y;
+                const auto check_visibility = skip_invisible && (c_lo < 0.f) && (c_hi > 0.f);
+                const auto rho_margin = l_vx_x + l_vx_y;
+
+                #pragma omp parallel
                 {
-                    for(auto l = 0u; l < v_dim_y; ++l)
+                    /* Everything but the vertical detector coordinate is constant along z. Compute these values
+                     * once per (k, l) column and projection and keep them for the current brick. */
+                    auto h_tile = std::make_unique<float[]>(tile_batch_size);
+                    auto v_scale_tile = std::make_unique<float[]>(tile_batch_size);
+                    auto w_tile = std::make_unique<float[]>(tile_batch_size);
+
+                    // voxels of each brick row inside the field of view
+                    auto fov_first = std::make_unique<std::uint32_t[]>(tile);
+                    auto fov_last = std::make_unique<std::uint32_t[]>(tile);
+
+                    #pragma omp for collapse(2) schedule(dynamic)
+                    for(auto t_y = 0u; t_y < tiles_y; ++t_y)
                     {
-                        for(auto k = 0u; k < v_dim_x; ++k)
+                        for(auto t_x = 0u; t_x < tiles_x; ++t_x)
                         {
-                            const auto coord = k + l * v_dim_x + m * v_dim_x * v_dim_y;
+                            // first voxel of this brick and its extent -- bricks at the border may be smaller
+                            const auto k_0 = t_x * tile;
+                            const auto l_0 = t_y * tile;
+                            const auto k_num = std::min(tile, v_dim_x - k_0);
+                            const auto l_num = std::min(tile, v_dim_y - l_0);
 
-                            // add ROI offset -- this should get optimized away for enable_roi == false
-                            if(enable_roi)
+                            const auto k_first = static_cast<std::int64_t>(enable_roi ? k_0 + roi.x1 : k_0);
+                            auto empty = true;
+                            for(auto l = 0u; l < l_num; ++l)
                             {
-                                k += roi.x1;
-                                l += roi.y1;
-                                m += roi.z1;
+                                const auto l_full = enable_roi ? l_0 + l + roi.y1 : l_0 + l;
+                                const auto y_l = vol_centered_coordinate(l_full, v_dim_y_full, l_vx_y);
+                                const auto x_r_sq = r_fov * r_fov - y_l * y_l;
+
+                                auto range = std::make_pair(0u, 0u);
+                                if(x_r_sq >= 0.f)
+                                    range = inner_range(std::sqrt(x_r_sq), x_0, l_vx_x, k_first, k_num);
+
+                                fov_first[l] = range.first;
+                                fov_last[l] = range.second;
+                                empty = empty && (range.first == range.second);
                             }
 
-                            // add offset for the current subvolume
-                            m += offset;
-
-                            // get centered coordinates -- volume center is at (0, 0, 0)
-                            const auto x_k = vol_centered_coordinate(k, v_dim_x_full, l_vx_x);
-                            const auto y_l = vol_centered_coordinate(l, v_dim_y_full, l_vx_y);
-                            const auto z_m = vol_centered_coordinate(m, v_dim_z_full, l_vx_z);
-
-                            // rotate coordinates
-                            const auto s = x_k * cos + y_l * sin;
-                            const auto t = -x_k * sin + y_l * cos;
-
-                            // project rotated coordinates
-                            const auto factor = d_sd / (s + d_so);
-                            const auto h = proj_real_coordinate(t * factor,
-                                                                p_dim_x,
-                                                                l_px_x,
-                                                                delta_s);
-                            const auto v = proj_real_coordinate(z_m * factor,
-                                                                p_dim_y,
-                                                                l_px_y,
-                                                                delta_t);
-                            
-                            // get projection value through interpolation
-                            const auto det = interpolate(p_ptr, h, v, p_dim_x, p_dim_y);
-                            
-                            // backproject
-                            const auto u = -(d_so / (s + d_so));
-                            vol_ptr[coord] += 0.5f * det * u * u;
-
-                            // restore old coordinates
-                            m -= offset;
-                            if(enable_roi)
+                            // the whole brick is located outside of the field of view
+                            if(empty)
+                                continue;
+
+                            for(auto n = 0u; n < p_num; ++n)
                             {
-                                k -= roi.x1;
-                                l -= roi.y1;
-                                m -= roi.z1;
+                                const auto sin = sins[n];
+                                const auto cos = coss[n];
+
+                                for(auto l = 0u; l < l_num; ++l)
+                                {
+                                    // add ROI offset -- this should get optimized away for enable_roi == false
+                                    const auto l_full = enable_roi ? l_0 + l + roi.y1 : l_0 + l;
+                                    const auto y_l = vol_centered_coordinate(l_full, v_dim_y_full, l_vx_y);
+
+                                    const auto col_off = n * tile_area + l * static_cast<std::size_t>(tile);
+                                    for(auto k = fov_first[l]; k < fov_last[l]; ++k)
+                                    {
+                                        const auto k_full = enable_roi ? k_0 + k + roi.x1 : k_0 + k;
+
+                                        // get centered coordinates -- volume center is at (0, 0, 0)
+                                        const auto x_k = vol_centered_coordinate(k_full, v_dim_x_full, l_vx_x);
+
+                                        // rotate coordinates
+                                        const auto s = x_k * cos + y_l * sin;
+                                        const auto t = -x_k * sin + y_l * cos;
+
+                                        // project rotated coordinates
+                                        const auto factor = d_sd / (s + d_so);
+                                        h_tile[col_off + k] = proj_real_coordinate(t * factor, p_dim_x, l_px_x, delta_s);
+                                        v_scale_tile[col_off + k] = factor / l_px_y;
+
+                                        // distance weight
+                                        const auto u = -(d_so / (s + d_so));
+                                        w_tile[col_off + k] = 0.5f * u * u;
+                                    }
+                                }
+                            }
+
+                            // walk along z -- only the vertical detector coordinate changes
+                            for(auto m = 0u; m < v_dim_z; ++m)
+                            {
+                                // add ROI and subvolume offsets
+                                const auto m_full = (enable_roi ? m + roi.z1 : m) + offset;
+                                const auto z_m = vol_centered_coordinate(m_full, v_dim_z_full, l_vx_z);
+
+                                // minimal radius of voxels in this slice that are hit by at least one projection
+                                auto rho_min = 0.f;
+                                if(check_visibility)
+                                    rho_min = (z_m >= 0.f ? z_m * d_sd / c_hi : z_m * d_sd / c_lo) - d_so - rho_margin;
+
+                                /* The brick's rows stay in cache while all projections of the batch are accumulated,
+                                 * so they are only transferred from and to main memory once per batch. */
+                                for(auto l = 0u; l < l_num; ++l)
+                                {
+                                    auto row = vol_ptr + m * slice_size + (l_0 + l) * static_cast<std::size_t>(v_dim_x)
+                                               + k_0;
+
+                                    // split the row if its center is never hit
+                                    const auto first = fov_first[l];
+                                    const auto last = fov_last[l];
+                                    auto gap = std::make_pair(last, last);
+                                    if(rho_min > 0.f)
+                                    {
+                                        const auto l_full = enable_roi ? l_0 + l + roi.y1 : l_0 + l;
+                                        const auto y_l = vol_centered_coordinate(l_full, v_dim_y_full, l_vx_y);
+                                        const auto x_e_sq = rho_min * rho_min - y_l * y_l;
+                                        if(x_e_sq > 0.f)
+                                        {
+                                            gap = inner_range_open(std::sqrt(x_e_sq), x_0, l_vx_x, k_first, k_num);
+                                            gap.first = std::min(std::max(gap.first, first), last);
+                                            gap.second = std::min(std::max(gap.second, gap.first), last);
+                                        }
+                                    }
+
+                                    for(auto n = 0u; n < p_num; ++n)
+                                    {
+                                        const auto col_off = n * tile_area + l * static_cast<std::size_t>(tile);
+                                        const auto h_n = h_tile.get() + col_off;
+                                        const auto v_scale_n = v_scale_tile.get() + col_off;
+                                        const auto w_n = w_tile.get() + col_off;
+
+                                        if(gap.first > first)
+                                            kernel(row + first, p_ptrs[n], h_n + first, v_scale_n + first, w_n + first,
+                                                   z_m, v_0, gap.first - first, p_dim_x, p_dim_y);
+
+                                        if(last > gap.second)
+                                            kernel(row + gap.second, p_ptrs[n], h_n + gap.second,
+                                                   v_scale_n + gap.second, w_n + gap.second,
+                                                   z_m, v_0, last - gap.second, p_dim_x, p_dim_y);
+                                    }
+                                }
                             }
                         }
                     }
@@ -153,11 +518,15 @@ namespace paris
             }
         }
 
-        auto backproject(const projection_device_type& p, volume_device_type& v, std::uint32_t v_offset,
+        auto backproject(const std::vector<projection_device_type>& p, volume_device_type& v, std::uint32_t v_offset,
                          const detector_geometry& det_geo, const volume_geometry& vol_geo,
-                         bool enable_roi, const region_of_interest& roi, float sin, float cos,
-                         float delta_s, float delta_t) noexcept -> void
+                         bool enable_roi, const region_of_interest& roi,
+                         const std::vector<float>& sin, const std::vector<float>& cos,
+                         float delta_s, float delta_t, bool skip_invisible) noexcept -> void
         {
+            if(p.empty())
+                return;
+
             // constants for the backprojection - these never change
             static const auto v_dim_x_full = vol_geo.dim_x;
             static const auto v_dim_y_full = vol_geo.dim_y;
@@ -176,26 +545,47 @@ namespace paris
             static const auto d_so = det_geo.d_so;
             static const auto d_sd = std::abs(det_geo.d_so) + std::abs(det_geo.d_od);
 
-            // variable for the backprojection - this might change between subvolumes
-            thread_local static auto offset = v_offset;
+            // pick the widest vector kernel supported by this CPU
+            static const auto kernel = select_row_kernel();
+
+            /* Detector pixels covered by one voxel at the highest magnification, i.e. for the voxels closest to the
+             * source. This determines how large the projected footprint of a brick becomes. */
+            static const auto r_max = std::sqrt(std::pow(static_cast<float>(v_dim_x_full) * l_vx_x, 2.f) +
+                                                std::pow(static_cast<float>(v_dim_y_full) * l_vx_y, 2.f)) / 2.f;
+            static const auto mag_max = (std::abs(d_so) > r_max) ? d_sd / (std::abs(d_so) - r_max)
+                                                                 : d_sd / std::abs(d_so);
+            static const auto px_per_vx_h = std::sqrt(2.f) * l_vx_x * mag_max / l_px_x;
+            static const auto px_per_vx_v = l_vx_z * mag_max / l_px_y;
+
+            // all projections share the same dimensions
+            const auto p_dim_x = p.front().dim_x;
+            const auto p_dim_y = p.front().dim_y;
+            const auto p_num = static_cast<std::uint32_t>(p.size());
+
+            const auto tile = make_tile_size(p_num, px_per_vx_h, px_per_vx_v);
+
+            auto p_ptrs = std::vector<const float*>{};
+            p_ptrs.reserve(p.size());
+            for(auto&& proj : p)
+                p_ptrs.push_back(proj.buf.get());
 
             // backproject and apply ROI as needed
             if(enable_roi)
                 do_backprojection<true>(v.buf.get(), v.dim_x, v.dim_y, v.dim_z,
-                                        p.buf.get(), p.dim_x, p.dim_y,
-                                        offset,
+                                        p_ptrs.data(), p_dim_x, p_dim_y, p_num,
+                                        v_offset,
                                         v_dim_x_full, v_dim_y_full, v_dim_z_full,
                                         l_vx_x, l_vx_y, l_vx_z,
                                         l_px_x, l_px_y, d_so, d_sd, d_s, d_t,
-                                        sin, cos, roi);
+                                        sin.data(), cos.data(), roi, skip_invisible, tile, kernel);
             else
                 do_backprojection<false>(v.buf.get(), v.dim_x, v.dim_y, v.dim_z,
-                                         p.buf.get(), p.dim_x, p.dim_y,
-                                         offset,
+                                         p_ptrs.data(), p_dim_x, p_dim_y, p_num,
+                                         v_offset,
                                          v_dim_x_full, v_dim_y_full, v_dim_z_full,
                                          l_vx_x, l_vx_y, l_vx_z,
                                          l_px_x, l_px_y, d_so, d_sd, d_s, d_t,
-                                         sin, cos, roi);
+                                         sin.data(), cos.data(), roi, skip_invisible, tile, kernel);
         }
     }
 }
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include <omp.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "backend.h"
+
+namespace paris
+{
+    namespace openmp
+    {
+        namespace
+        {
+            // the team size before any split, the same for every thread that has not called omp_set_num_threads()
+            auto available_threads() -> int
+            {
+                static const auto num = omp_get_max_threads();
+                return num;
+            }
+
+            auto filter_share(std::uint16_t filter_threads) -> int
+            {
+                const auto num = available_threads();
+                if(num < 2)
+                    return 1;
+
+                const auto share = filter_threads != 0u ? int{filter_threads} : num / 4;
+                return std::min(std::max(share, 1), num - 1);
+            }
+        }
+
+        auto use_filter_threads(std::uint16_t filter_threads) -> void
+        {
+            omp_set_num_threads(filter_share(filter_threads));
+        }
+
+        auto use_backprojection_threads(std::uint16_t filter_threads) -> void
+        {
+            const auto filter = filter_share(filter_threads);
+            const auto backprojection = std::max(available_threads() - filter, 1);
+            BOOST_LOG_TRIVIAL(info) << "Using " << filter << " thread(s) for filtering and " << backprojection
+                                    << " for backprojection";
+            omp_set_num_threads(backprojection);
+        }
+    }
+}
@@ -20,13 +20,19 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
-#include <numeric>
+#include <string>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
 
 #include <fftw3.h>
 
+#include "../cache.h"
 #include "backend.h"
 
 namespace paris
@@ -51,9 +57,11 @@ namespace paris
 
             auto make_filter_real(float* r, std::uint32_t size, float tau) -> void
             {
+                // j in wrap-around order -> the kernel is symmetric for even and odd sizes
                 auto js = std::make_unique<std::int32_t[]>(size);
-                auto j = -(static_cast<std::int32_t>(size) - 2) / 2;
-                std::iota(js.get(), js.get() + size, j);
+                for(auto x = 0u; x < size; ++x)
+                    js[x] = (x <= size / 2) ? static_cast<std::int32_t>(x)
+                                            : static_cast<std::int32_t>(x) - static_cast<std::int32_t>(size);
 
                 auto pi_f = static_cast<float>(M_PI);
 
@@ -72,61 +80,140 @@ namespace paris
                 }
             }   
 
-            auto expand(const float* src, std::uint32_t src_dim_x,
-                              float* dst, std::uint32_t dst_dim_x, std::uint32_t dim_y) noexcept -> void
+            // number of detector rows transformed by a single plan execution
+            constexpr auto rows_per_chunk = 16u;
+
+            struct filter_workspace
             {
-                // copy original projection to expanded projection
-                #pragma omp parallel for collapse(2)
-                for(auto y = 0u; y < dim_y; ++y)
+                filter_workspace() = default;
+                filter_workspace(const filter_workspace&) = delete;
+                auto operator=(const filter_workspace&) -> filter_workspace& = delete;
+
+                ~filter_workspace()
                 {
-                    for(auto x = 0u; x < dst_dim_x; ++x)
+                    // destroy the plans before p_exp is released, like the planner this is not thread-safe
+                    #pragma omp critical(paris_fftw_planner)
                     {
-                        if(x < src_dim_x)
-                            dst[x + y * dst_dim_x] = src[x + y * src_dim_x];
-                        else
-                            dst[x + y * dst_dim_x] = 0.f;
+                        if(forward != nullptr)
+                            fftwf_destroy_plan(forward);
+                        if(inverse != nullptr)
+                            fftwf_destroy_plan(inverse);
                     }
                 }
+
+                std::uint32_t filter_size = 0u;
+                std::unique_ptr<float[], fftw_deleter> p_exp;
+                fftwf_plan forward = nullptr;
+                fftwf_plan inverse = nullptr;
+            };
+
+            auto make_workspace(std::uint32_t filter_size) -> std::unique_ptr<filter_workspace>
+            {
+                // dimensionality of the FFT - 1 in this case
+                constexpr auto rank = 1;
+
+                // FFT size for each dimension
+                const auto n = static_cast<int>(filter_size);
+
+                // batched FFT -> set batch size
+                constexpr auto batch = static_cast<int>(rows_per_chunk);
+
+                // set distance between the first elements of two successive lines
+                const auto p_exp_dist = static_cast<int>(filter_size);
+
+                // set distance between two successive elements
+                constexpr auto p_exp_stride = 1;
+
+                // set storage dimensions of data in memory
+                const auto p_exp_nembed = p_exp_dist;
+
+                // in-place half-complex transforms -> no complex workspace required
+                constexpr auto forward_kind = FFTW_R2HC;
+                constexpr auto inverse_kind = FFTW_HC2R;
+
+                auto ws = std::make_unique<filter_workspace>();
+                ws->filter_size = filter_size;
+                ws->p_exp = make_ptr<float>(filter_size, rows_per_chunk);
+
+                // the FFTW planner is not thread-safe
+                #pragma omp critical(paris_fftw_planner)
+                {
+                    ws->forward = fftwf_plan_many_r2r(rank, &n, batch,
+                                                      ws->p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                      ws->p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                      &forward_kind, FFTW_MEASURE);
+
+                    ws->inverse = fftwf_plan_many_r2r(rank, &n, batch,
+                                                      ws->p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                      ws->p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist,
+                                                      &inverse_kind, FFTW_MEASURE);
+                }
+
+                return ws;
             }
 
-            auto do_filtering(fftwf_complex* in, const fftwf_complex* filter,
-                              std::uint32_t dim_x, std::uint32_t dim_y) noexcept -> void
+            /*
+             * Gathers rows [first, first + num) of the batch into the workspace. Row r is row r % dim_y of projection
+             * r / dim_y, so a chunk may span several projections. Unused rows of the last chunk are zeroed.
+             */
+            auto expand(const std::vector<projection_device_type>& p, const float* w, std::uint32_t first,
+                        std::uint32_t num, float* dst, std::uint32_t dst_dim_x) noexcept -> void
             {
-                #pragma omp parallel for collapse(2)
-                for(auto y = 0u; y < dim_y; ++y)
+                // all projections share the same dimensions
+                const auto dim_y = p.front().dim_y;
+
+                for(auto i = 0u; i < rows_per_chunk; ++i)
                 {
-                    for(auto x = 0u; x < dim_x; ++x)
+                    const auto dst_row = dst + i * dst_dim_x;
+                    if(i >= num)
                     {
-                        auto coord = x + y * dim_x;
-                        in[coord][0] *= filter[x][0];
-                        in[coord][1] *= filter[x][1];
+                        std::fill(dst_row, dst_row + dst_dim_x, 0.f);
+                        continue;
                     }
+
+                    const auto& proj = p[(first + i) / dim_y];
+                    const auto y = (first + i) % dim_y;
+                    const auto src_row = proj.buf.get() + y * proj.dim_x;
+                    const auto w_row = w + y * proj.dim_x;
+
+                    // copy weighted original row to expanded row
+                    for(auto x = 0u; x < proj.dim_x; ++x)
+                        dst_row[x] = src_row[x] * w_row[x];
+
+                    std::fill(dst_row + proj.dim_x, dst_row + dst_dim_x, 0.f);
                 }
             }
 
-            auto shrink(const float* src, std::uint32_t src_dim_x,
-                              float* dst, std::uint32_t dst_dim_x, std::uint32_t dim_y) noexcept -> void
+            /*
+             * The filter is real, so both the real and the imaginary part of a frequency are scaled by the same value.
+             * In half-complex order this is a plain element-wise multiplication.
+             */
+            auto do_filtering(float* __restrict__ in, const float* __restrict__ filter,
+                              std::uint32_t dim_x, std::uint32_t dim_y) noexcept -> void
             {
-                #pragma omp parallel for collapse(2)
                 for(auto y = 0u; y < dim_y; ++y)
                 {
-                    for(auto x = 0u; x < dst_dim_x; ++x)
-                    {
-                        dst[x + y * dst_dim_x] = src[x + y * src_dim_x];
-                    }
+                    const auto row = in + y * dim_x;
+
+                    #pragma omp simd
+                    for(auto x = 0u; x < dim_x; ++x)
+                        row[x] *= filter[x];
                 }
             }
 
-            auto normalize(float* src, std::uint32_t dim_x, std::uint32_t dim_y, std::uint32_t filter_size) noexcept
+            // scatters the filtered rows back into their projections, cropping them to the original width
+            auto shrink(const float* src, std::uint32_t src_dim_x,
+                        std::vector<projection_device_type>& p, std::uint32_t first, std::uint32_t num) noexcept
                 -> void
             {
-                #pragma omp parallel for collapse(2)
-                for(auto y = 0u; y < dim_y; ++y)
+                const auto dim_y = p.front().dim_y;
+
+                for(auto i = 0u; i < num; ++i)
                 {
-                    for(auto x = 0u; x < dim_x; ++x)
-                    {
-                        src[x + y * dim_x] /= static_cast<float>(filter_size);
-                    }
+                    auto& proj = p[(first + i) / dim_y];
+                    const auto y = (first + i) % dim_y;
+                    const auto src_row = src + i * src_dim_x;
+                    std::copy(src_row, src_row + proj.dim_x, proj.buf.get() + y * proj.dim_x);
                 }
             }
         }
@@ -136,86 +223,101 @@ namespace paris
             fftwf_free(p);
         }
 
-        auto make_filter(std::uint32_t size, float tau) -> filter_buffer_type
+        auto make_filter(std::uint32_t size, float tau, const std::string& cache_file) -> filter_buffer_type
         {
+            auto k = make_ptr<float>(size);
+            if(!cache_file.empty() && read_cache_file(cache_file, k.get(), size))
+                return k;
+
             // Note some FFTW quirks: Input initialization has to be done AFTER plan creation,
             // otherwise it will be overwritten
-            const auto size_trans = size / 2 + 1;
             const auto n = static_cast<int>(size);
 
             auto r = make_ptr<float>(size);
-            auto k = make_ptr<fftwf_complex>(size_trans);
+            auto hc = make_ptr<float>(size);
 
-            auto plan = fftwf_plan_dft_r2c_1d(n, r.get(), k.get(), FFTW_MEASURE | FFTW_PRESERVE_INPUT);
+            auto plan = fftwf_plan_r2r_1d(n, r.get(), hc.get(), FFTW_R2HC, FFTW_MEASURE | FFTW_PRESERVE_INPUT);
 
             make_filter_real(r.get(), size, tau);
 
             fftwf_execute(plan);
-            
+            fftwf_destroy_plan(plan);
+
+            // FFTW's inverse transform is unnormalized -> fold 1 / size into the filter
+            const auto scale = tau / static_cast<float>(size);
+
+            /* hc holds r_0, r_1, ..., r_size/2, i_(size+1)/2-1, ..., i_1. Slot x and slot size - x belong to the same
+             * frequency and get the same filter value. */
             #pragma omp parallel for
-            for(auto x = 0u; x < size_trans; ++x)
+            for(auto x = 0u; x < size; ++x)
             {
-                auto result = tau * std::abs(std::sqrt(std::pow(k[x][0], 2.f) + std::pow(k[x][1], 2.f)));
+                const auto f = (x <= size / 2) ? x : size - x;
+                const auto re = hc[f];
+                const auto im = (f > 0u && f < size - f) ? hc[size - f] : 0.f;
 
-                k[x][0] = result;
-                k[x][1] = result;
+                k[x] = scale * std::abs(std::sqrt(re * re + im * im));
             }
 
+            if(!cache_file.empty())
+                write_cache_file(cache_file, k.get(), size);
+
             return k;
         }
 
-        auto apply_filter(projection_device_type& p, const filter_buffer_type& k, std::uint32_t filter_size,
-                          std::uint32_t n_col) -> void
+        auto apply_filter(std::vector<projection_device_type>& p, const filter_buffer_type& k,
+                          const weight_buffer_type& w, std::uint32_t filter_size, std::uint32_t n_col) -> void
         {
-            // dimensionality of the FFT - 1 in this case
-            constexpr auto rank = 1;
+            const auto rows = static_cast<std::uint32_t>(p.size()) * n_col;
+            const auto chunks = (rows + rows_per_chunk - 1) / rows_per_chunk;
 
-            // FFT size for each dimension
-            static const auto n = static_cast<int>(filter_size);
-
-            // batched FFT -> set batch size
-            static const auto batch = static_cast<int>(n_col);
-
-            // allocate memory for expanded projection (projection width -> filter size)
-            thread_local static auto p_exp = make_ptr<float>(filter_size, n_col);
-
-            // allocate memory for transformed projection
-            static const auto size_trans = filter_size / 2 + 1;
-            thread_local static auto p_trans = make_ptr<fftwf_complex>(size_trans, n_col);
-
-            // set distance between the first elements of two successive lines
-            static const auto p_exp_dist = static_cast<int>(filter_size);
-            static const auto p_trans_dist = static_cast<int>(size_trans);
+            /* Every worker owns its buffers and single-threaded plans and transforms a chunk of rows at a time. This
+             * keeps the parallelism outside of FFTW and needs only one parallel region for the whole batch. */
+            #pragma omp parallel for schedule(dynamic)
+            for(auto c = 0u; c < chunks; ++c)
+            {
+                // the workspace outlives this call, rebuild it if the filter size has changed since
+                thread_local static auto ws = std::unique_ptr<filter_workspace>{};
+                if(ws == nullptr || ws->filter_size != filter_size)
+                {
+                    ws.reset();
+                    ws = make_workspace(filter_size);
+                }
 
-            // set distance between two successive elements
-            constexpr auto p_exp_stride = 1;
-            constexpr auto p_trans_stride = 1;
+                const auto first = c * rows_per_chunk;
+                const auto num = std::min(rows_per_chunk, rows - first);
 
-            // set storage dimensions of data in memory
-            static const auto p_exp_nembed = static_cast<int>(p_exp_dist);
-            static const auto p_trans_nembed = static_cast<int>(p_trans_dist);
+                // weight, expand and transform the rows
+                expand(p, w.get(), first, num, ws->p_exp.get(), filter_size);
+                fftwf_execute(ws->forward);
 
-            // create plans for forward and inverse FFT
-            thread_local static auto forward = fftwf_plan_many_dft_r2c(rank, &n, batch, p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist, p_trans.get(), &p_trans_nembed, p_trans_stride, p_trans_dist, FFTW_MEASURE | FFTW_PRESERVE_INPUT);
+                // apply filter to transformed rows
+                do_filtering(ws->p_exp.get(), k.get(), filter_size, rows_per_chunk);
 
-            thread_local static auto inverse = fftwf_plan_many_dft_c2r(rank, &n, batch,
-                                                          p_trans.get(), &p_trans_nembed, p_trans_stride, p_trans_dist,
-                                                          p_exp.get(), &p_exp_nembed, p_exp_stride, p_exp_dist,
-                                                          FFTW_MEASURE | FFTW_DESTROY_INPUT);
+                // inverse transformation
+                fftwf_execute(ws->inverse);
 
-            // expand and transform the projection
-            expand(p.buf.get(), p.dim_x, p_exp.get(), filter_size, n_col);
-            fftwf_execute(forward);
+                // shrink to original size, the filter already contains the normalization
+                shrink(ws->p_exp.get(), filter_size, p, first, num);
+            }
+        }
 
-            // apply filter to transformed projection
-            do_filtering(p_trans.get(), k.get(), size_trans, n_col);
+        auto import_fft_plans(const std::string& path) -> bool
+        {
+            return fftwf_import_wisdom_from_filename(path.c_str()) != 0;
+        }
 
-            // inverse transformation
-            fftwf_execute(inverse);
+        auto export_fft_plans(const std::string& path) -> void
+        {
+            // another run may be importing the plans right now
+            const auto tmp_path = temporary_cache_path(path);
+            if(fftwf_export_wisdom_to_filename(tmp_path.c_str()) == 0)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Could not write FFTW wisdom to " << path;
+                std::remove(tmp_path.c_str());
+                return;
+            }
 
-            // shrink to original size and normalize
-            shrink(p_exp.get(), filter_size, p.buf.get(), p.dim_x, n_col);
-            normalize(p.buf.get(), p.dim_x, p.dim_y, filter_size);
+            publish_cache_file(tmp_path, path);
         }
     }
 }
@@ -20,7 +20,20 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "../exception.h"
 #include "../geometry.h"
+#include "../program_options.h"
+#include "../source.h"
 #include "../subvolume_information.h"
 #include "backend.h"
 
@@ -28,16 +41,186 @@ namespace paris
 {
     namespace openmp
     {
-        auto make_subvolume_information(const volume_geometry& vol_geo, const detector_geometry& /* det_geo */) noexcept
-            -> subvolume_info
+        namespace
         {
-            auto subvol_info = subvolume_info{};
+            struct mem_info
+            {
+                std::size_t slice;
+                std::size_t fixed;
+            };
+
+            auto memory_info(const volume_geometry& vol_geo, const program_options& po) noexcept -> mem_info
+            {
+                auto info = mem_info{};
+
+                // the subvolume being computed plus the ones the sink is still writing
+                auto slice = static_cast<std::size_t>(vol_geo.dim_x) * vol_geo.dim_y * sizeof(float);
+                info.slice = (1u + po.write_behind) * slice;
+
+                /* One batch of projections plus the projection currently being loaded and its host copy. The padded
+                 * FFT buffers are at most four times as wide as a projection, both in real and in frequency space. */
+                auto proj = static_cast<std::size_t>(po.det_geo.n_row) * po.det_geo.n_col * sizeof(float);
+                auto fft = 2u * 4u * proj;
+                info.fixed = (po.batch_size + 2u) * proj + fft;
+
+                // the projection stream preprocesses ahead of the consumers, the source decodes ahead of the stream
+                info.fixed += (static_cast<std::size_t>(po.batch_size) + po.read_ahead) * proj;
+                info.fixed += source::max_buffered(po.read_ahead) * proj;
 
+                BOOST_LOG_TRIVIAL(info) << "The volume requires (roughly) " << slice * vol_geo.dim_z << " bytes";
+                BOOST_LOG_TRIVIAL(info) << "One projection requires (roughly) " << proj << " bytes";
+                BOOST_LOG_TRIVIAL(info) << "Projections in flight require (roughly) " << info.fixed << " bytes";
+
+                return info;
+            }
+
+            // memory for projections shared by the subvolumes, at least one slice has to fit besides
+            auto cache_share(std::size_t room, std::size_t slice, std::size_t requested) noexcept -> std::size_t
+            {
+                return std::min(requested, std::min(room / 2u, room - slice));
+            }
+
+            /* The thickest subvolume that is a multiple of step and whose last subvolume, which also takes the
+             * remaining slices, still fits into slices_max. 0 if there is none. */
+            auto aligned_slices(std::uint32_t dim_z, std::uint32_t slices_max, std::uint32_t step) noexcept
+                -> std::uint32_t
+            {
+                for(auto n = slices_max / step * step; n >= step; n -= step)
+                {
+                    if(dim_z % n <= slices_max - n)
+                        return n;
+                }
+
+                return 0u;
+            }
+
+            // memory the OS can hand out without swapping
+            auto available_memory() -> std::size_t
+            {
+                auto&& file = std::ifstream{"/proc/meminfo"};
+                auto key = std::string{};
+                auto value = std::size_t{};
+                auto unit = std::string{};
+                while(file >> key >> value >> unit)
+                {
+                    if(key == "MemAvailable:")
+                        return value * 1024u; // reported in kB
+                }
+
+                // no /proc/meminfo -> only count the free pages
+                auto pages = sysconf(_SC_AVPHYS_PAGES);
+                auto page_size = sysconf(_SC_PAGESIZE);
+                if(pages > 0 && page_size > 0)
+                    return static_cast<std::size_t>(pages) * static_cast<std::size_t>(page_size);
+
+                return 0u;
+            }
+        }
+
+        auto make_subvolume_information(const volume_geometry& vol_geo, const program_options& po) -> subvolume_info
+        {
+            auto info = memory_info(vol_geo, po);
+
+            auto mem_free = available_memory();
+            auto budget = mem_free;
+            if(po.max_memory != 0u)
+            {
+                if(mem_free != 0u && mem_free < po.max_memory)
+                    BOOST_LOG_TRIVIAL(warning) << "Requested memory limit of " << po.max_memory << " bytes exceeds "
+                                               << "the available memory, limiting to " << mem_free << " bytes";
+                else
+                    budget = po.max_memory;
+            }
+
+            auto subvol_info = subvolume_info{};
             subvol_info.geo.dim_x = vol_geo.dim_x;
             subvol_info.geo.dim_y = vol_geo.dim_y;
-            subvol_info.geo.dim_z = vol_geo.dim_z;
-            subvol_info.geo.remainder = 0u;
-            subvol_info.num = 1;
+
+            if(budget == 0u)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Could not determine the available memory, not splitting the volume";
+                subvol_info.geo.dim_z = vol_geo.dim_z;
+                subvol_info.geo.remainder = 0u;
+                subvol_info.num = 1;
+                subvol_info.projection_cache = 0u;
+                return subvol_info;
+            }
+
+            if(budget < info.fixed + info.slice)
+            {
+                BOOST_LOG_TRIVIAL(fatal) << "make_subvolume_information(): " << budget << " bytes are not enough "
+                                         << "to reconstruct a single slice";
+                throw stage_construction_error{"make_subvolume_information() failed"};
+            }
+
+            /* A single subvolume never needs a projection twice. Otherwise the projection cache comes out of the
+             * budget as well, but takes at most half of what is left so a tight budget does not end up as many thin
+             * slabs. Every projection that does not fit is read back from the spill file once per later slab. */
+            auto room = budget - info.fixed;
+            auto cache = std::size_t{0};
+            if(room / info.slice < vol_geo.dim_z)
+                cache = cache_share(room, info.slice, po.projection_cache);
+
+            auto slices_max = static_cast<std::uint32_t>(std::min<std::size_t>((room - cache) / info.slice,
+                                                                               vol_geo.dim_z));
+
+            /* Compressed volumes are written in layers of chunk_size slices. The writer holds back a layer cut by a
+             * subvolume boundary until the neighbouring subvolume arrives, so subvolumes start on layer boundaries
+             * and only the last layer of the volume is partial. If the budget allows no such split the held back
+             * layers are counted instead, at most one per boundary of the subvolumes being computed or written. */
+            auto aligned = std::uint32_t{0};
+            if(po.compression != "none" && slices_max < vol_geo.dim_z)
+            {
+                aligned = aligned_slices(vol_geo.dim_z, slices_max, po.chunk_size);
+                if(aligned == 0u)
+                {
+                    const auto depth = std::min(po.chunk_size, vol_geo.dim_z);
+                    const auto layer = std::size_t{depth} * vol_geo.dim_x * vol_geo.dim_y * sizeof(float);
+                    const auto staged = (2u + po.write_behind) * layer;
+                    if(room < staged + info.slice)
+                    {
+                        BOOST_LOG_TRIVIAL(fatal) << "make_subvolume_information(): " << budget << " bytes are not "
+                                                 << "enough to reconstruct a single slice with --chunk-size "
+                                                 << po.chunk_size;
+                        throw stage_construction_error{"make_subvolume_information() failed"};
+                    }
+
+                    BOOST_LOG_TRIVIAL(info) << "Subvolumes cannot start on chunk boundaries, reserving " << staged
+                                            << " bytes for partially written chunk layers";
+                    room -= staged;
+                    cache = cache_share(room, info.slice, po.projection_cache);
+                    slices_max = static_cast<std::uint32_t>(std::min<std::size_t>((room - cache) / info.slice,
+                                                                                   vol_geo.dim_z));
+                }
+            }
+
+            if(cache < po.projection_cache && slices_max < vol_geo.dim_z)
+                BOOST_LOG_TRIVIAL(info) << "Limiting the projection cache to " << cache << " bytes to stay within "
+                                        << "the memory budget";
+            subvol_info.projection_cache = cache;
+
+            auto vols_needed = std::uint32_t{};
+            if(aligned != 0u)
+            {
+                subvol_info.geo.dim_z = aligned;
+                vols_needed = vol_geo.dim_z / aligned;
+                subvol_info.geo.remainder = vol_geo.dim_z - vols_needed * aligned;
+            }
+            else
+            {
+                // the last subvolume also takes the remaining slices, so it has to fit as well
+                vols_needed = (vol_geo.dim_z + slices_max - 1u) / slices_max;
+                while((vol_geo.dim_z / vols_needed) + (vol_geo.dim_z % vols_needed) > slices_max)
+                    ++vols_needed;
+
+                subvol_info.geo.dim_z = vol_geo.dim_z / vols_needed;
+                subvol_info.geo.remainder = vol_geo.dim_z % vols_needed;
+            }
+            subvol_info.num = static_cast<int>(vols_needed);
+
+            BOOST_LOG_TRIVIAL(info) << "Memory budget: " << budget << " bytes, splitting the volume into "
+                                    << vols_needed << " slab(s) of " << subvol_info.geo.dim_z << " slices, "
+                                    << "keeping up to " << cache << " bytes of projections for later slabs";
 
             return subvol_info;
         }
@@ -22,23 +22,30 @@
 
 #include <cmath>
 #include <cstdint>
+#include <memory>
+#include <string>
 
+#include "../cache.h"
 #include "backend.h"
 
 namespace paris
 {
     namespace openmp
     {
-        auto weight(projection_device_type& p, float h_min, float v_min, float d_sd, float l_px_row, float l_px_col)
-            noexcept
-            -> void
+        auto make_weights(std::uint32_t n_row, std::uint32_t n_col, float h_min, float v_min, float d_sd,
+                          float l_px_row, float l_px_col, const std::string& cache_file) -> weight_buffer_type
         {
+            auto w = std::make_unique<float[]>(n_row * n_col);
+
+            if(!cache_file.empty() && read_cache_file(cache_file, w.get(), n_row * n_col))
+                return w;
+
             #pragma omp parallel for collapse(2)
-            for(auto t = 0u; t < p.dim_y; ++t)
+            for(auto t = 0u; t < n_col; ++t)
             {
-                for(auto s = 0u; s < p.dim_x; ++s)
+                for(auto s = 0u; s < n_row; ++s)
                 {
-                    const auto coord = s + t * p.dim_x;
+                    const auto coord = s + t * n_row;
 
                     // prevent conversion warnings
                     const auto s_f = static_cast<float>(s);
@@ -49,11 +56,14 @@ namespace paris
                     const auto v_t = (l_px_col / 2) + t_f * l_px_col + v_min;
 
                     // calculate weight
-                    const auto w_st = d_sd / std::sqrt(d_sd * d_sd + h_s * h_s + v_t * v_t);
-
-                    p.buf[coord] *= w_st;
+                    w[coord] = d_sd / std::sqrt(d_sd * d_sd + h_s * h_s + v_t * v_t);
                 }
             }
+
+            if(!cache_file.empty())
+                write_cache_file(cache_file, w.get(), n_row * n_col);
+
+            return w;
         }
     }
 }
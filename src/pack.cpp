@@ -0,0 +1,341 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "backend.h"
+#include "convert.h"
+#include "mapped_file.h"
+#include "pack.h"
+#include "projection.h"
+
+namespace paris
+{
+    namespace pack
+    {
+        namespace
+        {
+            constexpr char magic[8] = {'P', 'A', 'R', 'I', 'S', 'P', 'K', '\0'};
+            // version 1 had no projection indices and no key, it is not read any more
+            constexpr auto version = std::uint32_t{2};
+            constexpr auto alignment = std::size_t{64};
+            constexpr auto angles_flag = std::uint32_t{1};
+
+            struct pack_header
+            {
+                char magic[8];
+                std::uint32_t version;
+                std::uint32_t type;             // pixel_type
+                std::uint32_t width;
+                std::uint32_t height;
+                std::uint32_t frames;
+                std::uint32_t flags;            // angles_flag if the index holds valid angles
+                std::uint64_t index_offset;
+                std::uint64_t data_offset;
+                std::uint64_t frame_stride;     // distance between two frames written by the converter
+                std::uint64_t key;
+            };
+            static_assert(sizeof(pack_header) == 64, "unexpected container header size");
+
+            struct index_entry
+            {
+                std::uint64_t offset;
+                float phi;
+                std::uint32_t idx;
+            };
+            static_assert(sizeof(index_entry) == 16, "unexpected container index entry size");
+
+            auto round_up(std::size_t n) noexcept -> std::size_t
+            {
+                return (n + alignment - 1u) / alignment * alignment;
+            }
+
+            auto pixel_size(std::uint32_t type) noexcept -> std::size_t
+            {
+                switch(type)
+                {
+                    case static_cast<std::uint32_t>(pixel_type::uint16): return sizeof(std::uint16_t);
+                    case static_cast<std::uint32_t>(pixel_type::float32): return sizeof(float);
+                    case static_cast<std::uint32_t>(pixel_type::float16): return sizeof(std::uint16_t);
+                    default: return 0u;
+                }
+            }
+
+            auto write_all(int fd, const void* buf, std::size_t n, std::size_t offset) -> void
+            {
+                auto pos = static_cast<const unsigned char*>(buf);
+                while(n > 0u)
+                {
+                    auto written = ::pwrite(fd, pos, n, static_cast<off_t>(offset));
+                    if(written == -1)
+                    {
+                        if(errno == EINTR)
+                            continue;
+                        throw std::system_error{errno, std::generic_category()};
+                    }
+
+                    pos += written;
+                    n -= static_cast<std::size_t>(written);
+                    offset += static_cast<std::size_t>(written);
+                }
+            }
+        }
+
+        struct handle
+        {
+            explicit handle(const std::string& path) : file{path} {}
+
+            mapped_file file;
+            pack_header header;
+            std::vector<index_entry> index;
+            std::size_t frame_size;
+            std::uint32_t frames;
+        };
+
+        auto handle_deleter::operator()(handle* h) noexcept -> void
+        {
+            delete h;
+        }
+
+        auto open(const std::string& path) -> handle_type
+        {
+            auto h = handle_type{new handle{path}};
+            const auto& file = h->file;
+            if(file.size() < sizeof(pack_header))
+            {
+                BOOST_LOG_TRIVIAL(warning) << "pack::open() could not open non-container file at " << path;
+                return handle_type{};
+            }
+
+            std::memcpy(&h->header, file.data(), sizeof(pack_header));
+            const auto& header = h->header;
+
+            if(std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "pack::open() could not open non-container file at " << path;
+                return handle_type{};
+            }
+            if(header.version != version)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "pack::open() encountered an unsupported container version at " << path;
+                return handle_type{};
+            }
+
+            const auto px_size = pixel_size(header.type);
+            if(px_size == 0u)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "pack::open() encountered an unsupported data type at " << path;
+                return handle_type{};
+            }
+
+            // a corrupt header must not overflow the bounds checks
+            if(header.index_offset > file.size()
+               || header.frames > (file.size() - header.index_offset) / sizeof(index_entry))
+            {
+                BOOST_LOG_TRIVIAL(warning) << "pack::open() encountered a truncated index at " << path;
+                return handle_type{};
+            }
+
+            h->index.resize(header.frames);
+            std::memcpy(h->index.data(), file.data() + header.index_offset, header.frames * sizeof(index_entry));
+            h->frame_size = static_cast<std::size_t>(header.width) * header.height * px_size;
+
+            // frames are stored in index order, the first missing frame ends the usable part
+            h->frames = 0u;
+            for(auto&& e : h->index)
+            {
+                if(e.offset > file.size() || h->frame_size > file.size() - e.offset)
+                {
+                    BOOST_LOG_TRIVIAL(warning) << "pack::open() encountered a truncated file at " << path;
+                    break;
+                }
+                ++h->frames;
+            }
+
+            return h;
+        }
+
+        auto frame_count(const handle& h) noexcept -> std::uint32_t
+        {
+            return h.frames;
+        }
+
+        auto frame_offset(const handle& h, std::uint32_t frame) noexcept -> std::size_t
+        {
+            return static_cast<std::size_t>(h.index[frame].offset);
+        }
+
+        auto projection_index(const handle& h, std::uint32_t frame) noexcept -> std::uint32_t
+        {
+            return h.index[frame].idx;
+        }
+
+        auto key(const handle& h) noexcept -> std::uint64_t
+        {
+            return h.header.key;
+        }
+
+        auto type(const handle& h) noexcept -> pixel_type
+        {
+            return static_cast<pixel_type>(h.header.type);
+        }
+
+        auto has_angles(const handle& h) noexcept -> bool
+        {
+            return (h.header.flags & angles_flag) != 0u;
+        }
+
+        auto angle(const handle& h, std::uint32_t frame) noexcept -> float
+        {
+            return h.index[frame].phi;
+        }
+
+        auto prefetch(const handle& h, std::uint32_t first, std::uint32_t num) noexcept -> void
+        {
+            if(first >= h.frames)
+                return;
+
+            num = std::min(num, h.frames - first);
+
+            // frames are usually contiguous -> a single hint covers the whole range
+            const auto begin = frame_offset(h, first);
+            const auto end = frame_offset(h, first + num - 1u) + h.frame_size;
+            if(end > begin)
+                h.file.prefetch(begin, end - begin);
+        }
+
+        auto read_frame(const handle& h, std::uint32_t frame) -> image_type
+        {
+            const auto width = h.header.width;
+            const auto height = h.header.height;
+            const auto pixels = static_cast<std::size_t>(width) * height;
+
+            const auto src = h.file.data() + frame_offset(h, frame);
+
+            auto img = backend::make_projection_host(width, height);
+            switch(h.header.type)
+            {
+                case static_cast<std::uint32_t>(pixel_type::uint16):
+                    convert_u16(src, img.buf.get(), pixels);
+                    break;
+
+                case static_cast<std::uint32_t>(pixel_type::float16):
+                    convert_f16(src, img.buf.get(), pixels);
+                    break;
+
+                default:
+                    std::memcpy(img.buf.get(), src, pixels * sizeof(float));
+                    break;
+            }
+
+            img.dim_x = width;
+            img.dim_y = height;
+            return img;
+        }
+
+        writer::writer(const std::string& path, std::uint32_t width, std::uint32_t height, pixel_type type,
+                       std::uint32_t frames)
+        : fd_{-1}, width_{width}, height_{height}, type_{type}
+        , data_offset_{round_up(sizeof(pack_header) + frames * sizeof(index_entry))}
+        , frame_stride_{round_up(static_cast<std::size_t>(width) * height
+                                 * pixel_size(static_cast<std::uint32_t>(type)))}
+        , indices_(frames, 0u), angles_(frames, 0.f)
+        {
+            fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if(fd_ == -1)
+                throw std::system_error{errno, std::generic_category()};
+
+            // the header is written last -> an interrupted conversion never leaves a valid container behind
+            const auto size = static_cast<off_t>(data_offset_ + frames * frame_stride_);
+            if(::posix_fallocate(fd_, 0, size) != 0 && ::ftruncate(fd_, size) == -1)
+            {
+                auto err = errno;
+                ::close(fd_);
+                throw std::system_error{err, std::generic_category()};
+            }
+        }
+
+        writer::~writer()
+        {
+            if(fd_ != -1)
+                ::close(fd_);
+        }
+
+        auto writer::write_frame(std::uint32_t frame, const float* pixels, std::uint32_t idx, float phi) -> void
+        {
+            const auto n = static_cast<std::size_t>(width_) * height_;
+
+            // padding bytes stay zero
+            auto buf = std::vector<unsigned char>(frame_stride_, 0u);
+            if(type_ == pixel_type::uint16)
+                convert_to_u16(pixels, buf.data(), n, 0.f, 1.f);
+            else if(type_ == pixel_type::float16)
+                convert_to_f16(pixels, buf.data(), n);
+            else
+                std::memcpy(buf.data(), pixels, n * sizeof(float));
+
+            write_all(fd_, buf.data(), buf.size(), data_offset_ + frame * frame_stride_);
+            indices_[frame] = idx;
+            angles_[frame] = phi;
+        }
+
+        auto writer::finish(bool enable_angles, std::uint64_t key) -> void
+        {
+            const auto frames = static_cast<std::uint32_t>(angles_.size());
+
+            auto index = std::vector<index_entry>(frames);
+            for(auto i = 0u; i < frames; ++i)
+                index[i] = index_entry{data_offset_ + i * frame_stride_, enable_angles ? angles_[i] : 0.f, indices_[i]};
+
+            write_all(fd_, index.data(), index.size() * sizeof(index_entry), sizeof(pack_header));
+
+            auto header = pack_header{};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.version = version;
+            header.type = static_cast<std::uint32_t>(type_);
+            header.width = width_;
+            header.height = height_;
+            header.frames = frames;
+            header.flags = enable_angles ? angles_flag : 0u;
+            header.index_offset = sizeof(pack_header);
+            header.data_offset = data_offset_;
+            header.frame_stride = frame_stride_;
+            header.key = key;
+            write_all(fd_, &header, sizeof(header), 0u);
+
+            if(::fsync(fd_) == -1)
+                throw std::system_error{errno, std::generic_category()};
+        }
+    }
+}
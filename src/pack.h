@@ -0,0 +1,128 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_PACK_H_
+#define PARIS_PACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backend.h"
+#include "projection.h"
+
+namespace paris
+{
+    /**
+     * Packed projection container: all projections of a scan in a single file, so that ingest needs one open() and
+     * a few large reads instead of one metadata round trip per projection.
+     *
+     * Layout (little endian):
+     *   header    64 bytes, see pack.cpp
+     *   index     one 16 byte entry per frame: byte offset of the pixels (uint64), angle in ° (float32),
+     *             projection index (uint32)
+     *   frames    uint16, float16 or float32 pixels, every frame starts at a multiple of 64 bytes
+     *
+     * The same format holds the filtered projection cache, the header then carries a key identifying the input.
+     */
+    namespace pack
+    {
+        using image_type = backend::projection_host_type;
+
+        enum class pixel_type : std::uint32_t
+        {
+            uint16  = 1,
+            float32 = 2,
+            float16 = 3
+        };
+
+        struct handle;
+        struct handle_deleter { auto operator()(handle* h) noexcept -> void; };
+        using handle_type = std::unique_ptr<handle, handle_deleter>;
+
+        /**
+         * Maps the container and parses header and index. Returns an empty handle if the file is not a valid
+         * container.
+         */
+        auto open(const std::string& path) -> handle_type;
+
+        // number of complete frames in the container
+        auto frame_count(const handle& h) noexcept -> std::uint32_t;
+
+        // byte offset of the frame's pixels inside the file
+        auto frame_offset(const handle& h, std::uint32_t frame) noexcept -> std::size_t;
+
+        // position of the frame in the original projection sequence
+        auto projection_index(const handle& h, std::uint32_t frame) noexcept -> std::uint32_t;
+
+        // key given to writer::finish(), 0 for plain containers
+        auto key(const handle& h) noexcept -> std::uint64_t;
+
+        // pixel type of the stored frames
+        auto type(const handle& h) noexcept -> pixel_type;
+
+        // true if the index holds the projection angles
+        auto has_angles(const handle& h) noexcept -> bool;
+        auto angle(const handle& h, std::uint32_t frame) noexcept -> float;
+
+        // hints the kernel to read the given frames in the background
+        auto prefetch(const handle& h, std::uint32_t first, std::uint32_t num) noexcept -> void;
+
+        // decodes a single frame, frames can be read in any order and from several threads
+        auto read_frame(const handle& h, std::uint32_t frame) -> image_type;
+
+        /**
+         * Writes a container. The file is preallocated, frames may be added in any order and from several threads.
+         * Throws std::system_error on I/O errors.
+         */
+        class writer
+        {
+            public:
+                writer(const std::string& path, std::uint32_t width, std::uint32_t height, pixel_type type,
+                       std::uint32_t frames);
+                ~writer();
+
+                writer(const writer&) = delete;
+                auto operator=(const writer&) -> writer& = delete;
+
+                // pixels must hold width * height values, uint16 containers round them to the nearest integer
+                auto write_frame(std::uint32_t frame, const float* pixels, std::uint32_t idx, float phi) -> void;
+
+                // writes the index, angles are only stored if enable_angles is set
+                auto finish(bool enable_angles, std::uint64_t key = 0u) -> void;
+
+            private:
+                int fd_;
+                std::uint32_t width_;
+                std::uint32_t height_;
+                pixel_type type_;
+                std::size_t data_offset_;
+                std::size_t frame_stride_;
+                std::vector<std::uint32_t> indices_;
+                std::vector<float> angles_;
+        };
+    }
+}
+
+#endif /* PARIS_PACK_H_ */
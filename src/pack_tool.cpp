@@ -0,0 +1,209 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include "filesystem.h"
+#include "frame_index.h"
+#include "his.h"
+#include "pack.h"
+#include "version.h"
+
+/*
+ * paris.pack - converts a directory of HIS files into a single projection container (see pack.h). The angle file
+ * is folded into the container index.
+ */
+namespace
+{
+    struct options
+    {
+        std::string input_path;
+        std::string output_path;
+        std::string angle_path;
+        std::string type;
+    };
+
+    auto make_options(int argc, char** argv) -> options
+    {
+        auto opts = options{};
+        try
+        {
+            boost::program_options::options_description desc{"Options"};
+            desc.add_options()
+                    ("help", "produce a help message")
+                    ("input", boost::program_options::value<std::string>(&opts.input_path)->required(), "Path to the HIS directory")
+                    ("output", boost::program_options::value<std::string>(&opts.output_path)->required(), "Path of the projection container")
+                    ("angles", boost::program_options::value<std::string>(&opts.angle_path), "Path to projection angles (optional)")
+                    ("type", boost::program_options::value<std::string>(&opts.type)->default_value("auto"), "Pixel type of the container: auto, uint16 or float32 (optional)");
+
+            boost::program_options::variables_map param_map;
+            boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), param_map);
+
+            if(param_map.count("help"))
+            {
+                std::cout << desc << std::endl;
+                std::exit(EXIT_SUCCESS);
+            }
+
+            boost::program_options::notify(param_map);
+
+            if(opts.type != "auto" && opts.type != "uint16" && opts.type != "float32")
+            {
+                std::cerr << "the option '--type' must be auto, uint16 or float32" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        catch(const boost::program_options::error& err)
+        {
+            std::cerr << err.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        return opts;
+    }
+
+    auto pack_projections(const options& opts) -> void
+    {
+        auto angles = std::vector<float>{};
+        if(!opts.angle_path.empty())
+            angles = paris::read_angles(opts.angle_path);
+
+        const auto index = paris::make_frame_index(paris::read_directory(opts.input_path), angles);
+        if(index.frames.empty())
+            throw std::runtime_error{opts.input_path + " does not contain any projections"};
+
+        // all files must share the frame size, uint16 is only chosen if no precision is lost
+        auto width = 0u;
+        auto height = 0u;
+        auto lossless = true;
+        for(auto&& path : index.paths)
+        {
+            auto h = paris::his::open(path);
+            if(h == nullptr)
+                throw std::runtime_error{path + " changed during conversion"};
+
+            if(width == 0u)
+            {
+                width = paris::his::width(*h);
+                height = paris::his::height(*h);
+            }
+            else if(paris::his::width(*h) != width || paris::his::height(*h) != height)
+                throw std::runtime_error{path + " has a different frame size"};
+
+            lossless = lossless && paris::his::fits_uint16(*h);
+        }
+
+        auto type = paris::pack::pixel_type::float32;
+        if(opts.type == "uint16" || (opts.type == "auto" && lossless))
+            type = paris::pack::pixel_type::uint16;
+
+        auto&& writer = paris::pack::writer{opts.output_path, width, height, type,
+                                            static_cast<std::uint32_t>(index.frames.size())};
+
+        // position of each file's first frame in the container
+        auto first = std::vector<std::size_t>(index.paths.size(), 0u);
+        for(auto i = index.frames.size(); i > 0u; --i)
+            first[index.frames[i - 1u].file] = i - 1u;
+
+        // files are decoded in parallel, the container is written with positional writes
+        const auto hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        const auto thread_num = std::min<std::size_t>(std::min(hw_threads, 8u), index.paths.size());
+
+        std::atomic<std::size_t> next{0u};
+        auto errors = std::vector<std::exception_ptr>(thread_num);
+        auto threads = std::vector<std::thread>{};
+        threads.reserve(thread_num);
+        for(auto t = std::size_t{0}; t < thread_num; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                try
+                {
+                    for(auto i = next++; i < index.paths.size(); i = next++)
+                    {
+                        auto h = paris::his::open(index.paths[i]);
+                        if(h == nullptr)
+                            throw std::runtime_error{index.paths[i] + " changed during conversion"};
+
+                        for(auto pos = first[i]; pos < index.frames.size() && index.frames[pos].file == i; ++pos)
+                        {
+                            const auto& e = index.frames[pos];
+                            auto img = paris::his::read_frame(*h, e.frame);
+                            writer.write_frame(e.idx, img.buf.get(), e.idx, e.phi);
+                        }
+                    }
+                }
+                catch(...)
+                {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+
+        for(auto&& t : threads)
+            t.join();
+
+        for(auto&& e : errors)
+        {
+            if(e != nullptr)
+                std::rethrow_exception(e);
+        }
+
+        writer.finish(index.has_angles);
+
+        BOOST_LOG_TRIVIAL(info) << "Wrote " << index.frames.size() << " projections ("
+                                << (type == paris::pack::pixel_type::uint16 ? "uint16" : "float32") << ") to "
+                                << opts.output_path;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    std::cout << "paris.pack - version " << paris::version << std::endl;
+
+    auto opts = make_options(argc, argv);
+
+    try
+    {
+        pack_projections(opts);
+    }
+    catch(const std::exception& err)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "paris.pack failed: " << err.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -20,6 +20,7 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
@@ -28,6 +29,7 @@
 
 #include <boost/program_options.hpp>
 
+#include "compression.h"
 #include "geometry.h"
 #include "program_options.h"
 #include "region_of_interest.h"
@@ -67,15 +69,32 @@ namespace paris
             // I/O options
             boost::program_options::options_description io{"Input/output options"};
             io.add_options()
-                    ("input", boost::program_options::value<std::string>(&po.input_path), "Path to projections (optional)")
+                    ("input", boost::program_options::value<std::string>(&po.input_path), "Path to the projection directory or container (optional)")
                     ("output", boost::program_options::value<std::string>(&po.output_path), "Output directory for the reconstructed volume (optional)")
-                    ("name", boost::program_options::value<std::string>(&po.prefix)->default_value("vol"), "Name of the reconstructed volume (optional)");
+                    ("name", boost::program_options::value<std::string>(&po.prefix)->default_value("vol"), "Name of the reconstructed volume (optional)")
+                    ("cache", boost::program_options::value<std::string>(&po.cache_path), "Directory for cached FFT plans and precomputed filter data (optional)")
+                    ("read-ahead", boost::program_options::value<std::uint16_t>(&po.read_ahead)->default_value(32), "Number of projections loaded in advance (optional)")
+                    ("write-behind", boost::program_options::value<std::uint16_t>(&po.write_behind)->default_value(1), "Number of subvolumes written in the background while the next one is computed, 0 = write synchronously (optional)")
+                    ("compression", boost::program_options::value<std::string>(&po.compression)->default_value("none"), "Compress the volume in chunks: none, lz4 or zstd (optional)")
+                    ("chunk-size", boost::program_options::value<std::uint32_t>(&po.chunk_size)->default_value(64), "Edge length of the compressed chunks in voxels (optional)")
+                    ("output-type", boost::program_options::value<std::string>(&po.output_type)->default_value("float32"), "Voxel type of the volume: float32, float16 or uint16 (optional)")
+                    ("window-min", boost::program_options::value<float>(&po.window_min), "Value mapped to 0 in uint16 volumes, estimated from the volume if omitted, required if the volume is split (optional)")
+                    ("window-max", boost::program_options::value<float>(&po.window_max), "Value mapped to 65535 in uint16 volumes, estimated from the volume if omitted, required if the volume is split (optional)")
+                    ("pyramid", boost::program_options::value<std::uint16_t>(&po.pyramid_levels)->default_value(0), "Number of mean-pooled levels written next to the volume as <name>_2x, <name>_4x, ... (optional)")
+                    ("direct-io", "Write large parts of the volume with O_DIRECT, bypassing the page cache (optional)")
+                    ("filtered-cache", "Store the weighted and filtered projections next to the input and reuse them in later runs (optional)")
+                    ("filtered-cache-type", boost::program_options::value<std::string>(&po.filtered_cache_type)->default_value("float32"), "Precision of the filtered projection cache: float32 or float16 (optional)");
 
             // Reconstruction options
             boost::program_options::options_description recon{"Reconstruction options"};
             recon.add_options()
                     ("angles", boost::program_options::value<std::string>(&po.angle_path), "Path to projection angles (optional)")
-                    ("quality", boost::program_options::value<std::uint16_t>(&po.quality)->default_value(1), "Quality setting (optional)");
+                    ("quality", boost::program_options::value<std::uint16_t>(&po.quality)->default_value(1), "Quality setting (optional)")
+                    ("batch-size", boost::program_options::value<std::uint16_t>(&po.batch_size)->default_value(8), "Number of projections backprojected at once (optional)")
+                    ("filter-threads", boost::program_options::value<std::uint16_t>(&po.filter_threads)->default_value(0), "OpenMP threads filtering projections while the others backproject, 0 = a quarter of the cores (optional)")
+                    ("skip-invisible", "Skip voxels that are not hit by any projection (optional)")
+                    ("max-memory", boost::program_options::value<std::size_t>(&po.max_memory)->default_value(0), "Upper memory limit for the reconstruction in MiB, 0 = available memory (optional)")
+                    ("projection-cache", boost::program_options::value<std::size_t>(&po.projection_cache)->default_value(1024), "Memory in MiB for preprocessed projections shared by the subvolumes, part of the memory budget, the rest is spilled to TMPDIR (optional)");
 
             // Geometry file
             boost::program_options::options_description geom{"Geometry file"};
@@ -135,8 +154,88 @@ namespace paris
             if(param_map.count("angles"))
                 po.enable_angles = true;
 
+            if(param_map.count("skip-invisible"))
+                po.skip_invisible = true;
+
+            if(param_map.count("direct-io"))
+                po.direct_io = true;
+
+            if(param_map.count("filtered-cache"))
+                po.enable_filtered_cache = true;
+
+            if(param_map.count("filtered-cache-type"))
+            {
+                const auto& type = param_map["filtered-cache-type"].as<std::string>();
+                if(type != "float32" && type != "float16")
+                {
+                    std::cerr << "the option '--filtered-cache-type' must be float32 or float16" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+
+            if(param_map.count("compression"))
+            {
+                const auto& name = param_map["compression"].as<std::string>();
+                if(name != "none" && name != "lz4" && name != "zstd")
+                {
+                    std::cerr << "the option '--compression' must be none, lz4 or zstd" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+
+                if(!compression::available(compression::from_string(name)))
+                {
+                    std::cerr << "PARIS was built without " << name << " support" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+
+            if(param_map.count("output-type"))
+            {
+                const auto& type = param_map["output-type"].as<std::string>();
+                if(type != "float32" && type != "float16" && type != "uint16")
+                {
+                    std::cerr << "the option '--output-type' must be float32, float16 or uint16" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+
+            if(param_map.count("window-min") || param_map.count("window-max"))
+            {
+                po.enable_window = true;
+                if(param_map.count("window-min") == 0) print_missing("window-min");
+                if(param_map.count("window-max") == 0) print_missing("window-max");
+
+                if(!(param_map["window-max"].as<float>() > param_map["window-min"].as<float>()))
+                {
+                    std::cerr << "the option '--window-max' must be greater than '--window-min'" << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+
+            if(param_map.count("pyramid") && param_map["pyramid"].as<std::uint16_t>() > 16)
+            {
+                std::cerr << "the option '--pyramid' must not exceed 16" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
+            if(param_map.count("chunk-size") && param_map["chunk-size"].as<std::uint32_t>() == 0)
+            {
+                std::cerr << "the option '--chunk-size' must be greater than 0" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
+            if(param_map.count("batch-size") && param_map["batch-size"].as<std::uint16_t>() == 0)
+            {
+                std::cerr << "the option '--batch-size' must be greater than 0" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
             boost::program_options::notify(param_map);
 
+            // MiB -> bytes
+            po.max_memory *= 1024u * 1024u;
+            po.projection_cache *= 1024u * 1024u;
+
             auto&& file = std::ifstream{geometry_path.c_str()};
             if(file)
                 boost::program_options::store(boost::program_options::parse_config_file(file, geom), geom_map);
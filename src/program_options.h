@@ -23,6 +23,7 @@
 #ifndef PARIS_PROGRAM_OPTIONS_H_
 #define PARIS_PROGRAM_OPTIONS_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -39,6 +40,19 @@ namespace paris
         std::string input_path;
         std::string output_path;
         std::string prefix;
+        std::string cache_path;
+        std::uint16_t read_ahead;
+        bool direct_io;
+        std::uint16_t write_behind;
+        std::string compression;
+        std::uint32_t chunk_size;
+        std::string output_type;
+        bool enable_window;
+        float window_min;
+        float window_max;
+        std::uint16_t pyramid_levels;
+        bool enable_filtered_cache;
+        std::string filtered_cache_type;
 
         bool enable_roi;
         region_of_interest roi;
@@ -47,6 +61,12 @@ namespace paris
         std::string angle_path;
 
         std::uint16_t quality;
+        std::uint16_t batch_size;
+        std::uint16_t filter_threads;
+        bool skip_invisible;
+
+        std::size_t max_memory;
+        std::size_t projection_cache;
     };
 
     auto make_program_options(int argc, char** argv) -> program_options;
@@ -0,0 +1,470 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "backend.h"
+#include "cache.h"
+#include "filesystem.h"
+#include "filtering.h"
+#include "geometry.h"
+#include "loader.h"
+#include "pack.h"
+#include "program_options.h"
+#include "projection.h"
+#include "projection_stream.h"
+#include "source.h"
+
+namespace paris
+{
+    struct projection_stream::state
+    {
+        struct slot
+        {
+            value_type projection;          // empty once all consumers have it or it was spilled
+            std::uint32_t pending = 0u;     // consumers that have not fetched it yet
+            std::size_t bytes = 0u;
+            bool spilling = false;
+            bool spilled = false;
+            std::size_t offset = 0u;        // position in the spill file
+
+            std::uint32_t dim_x = 0u;
+            std::uint32_t dim_y = 0u;
+            std::uint32_t idx = 0u;
+            float phi = 0.f;
+        };
+
+        state(const program_options& po, std::size_t cache, backend::device_handle d)
+        : det_geo(po.det_geo), cache_path{po.cache_path}, batch_size{po.batch_size}
+        , lookahead{static_cast<std::size_t>(po.batch_size) + po.read_ahead}, cache_size{cache}
+        , filter_threads{po.filter_threads}
+        , device(d)
+        {}
+
+        // either the source and filtering or a valid filtered projection cache
+        std::unique_ptr<source> src;
+        pack::handle_type filtered;
+        bool has_angles = false;
+
+        // the filtered projection cache written by this run, moved to filtered_path once complete
+        std::unique_ptr<pack::writer> writer;
+        pack::pixel_type filtered_type = pack::pixel_type::float32;
+        std::string filtered_path;
+        std::string filtered_tmp_path;
+        std::uint64_t filtered_key = 0u;
+
+        detector_geometry det_geo;
+        std::string cache_path;
+        std::size_t batch_size;
+        std::size_t lookahead;      // the producer stays at most this far ahead of the fastest consumer
+        std::size_t cache_size;
+        std::uint16_t filter_threads;
+        backend::device_handle device;
+
+        std::mutex mutex;
+        std::condition_variable produced_cv;
+        std::condition_variable consumed_cv;
+
+        std::vector<slot> slots;
+        std::size_t produced = 0u;
+        std::size_t leader = 0u;    // next projection requested by the fastest consumer
+        std::size_t ram_bytes = 0u;
+        std::exception_ptr error;
+        bool stop = false;
+
+        int spill_fd = -1;
+        std::size_t spill_size = 0u;
+        std::size_t spill_num = 0u;
+
+        std::thread producer;
+    };
+
+    namespace
+    {
+        auto open_spill_file() -> int
+        {
+            const auto dir = boost::filesystem::temp_directory_path();
+            const auto name = (dir / "paris-spill-XXXXXX").string();
+            auto pattern = std::vector<char>(std::begin(name), std::end(name));
+            pattern.push_back('\0');
+
+            // the file disappears as soon as it is closed, even if the program crashes
+            auto fd = ::mkstemp(pattern.data());
+            if(fd == -1)
+                throw std::system_error{errno, std::generic_category()};
+            ::unlink(pattern.data());
+
+            BOOST_LOG_TRIVIAL(info) << "Projection cache is full, spilling preprocessed projections to "
+                                    << dir.string();
+            return fd;
+        }
+
+        auto write_spill(int fd, const float* src, std::size_t bytes, std::size_t offset) -> void
+        {
+            auto pos = reinterpret_cast<const unsigned char*>(src);
+            while(bytes > 0u)
+            {
+                auto n = ::pwrite(fd, pos, bytes, static_cast<off_t>(offset));
+                if(n == -1)
+                {
+                    if(errno == EINTR)
+                        continue;
+                    throw std::system_error{errno, std::generic_category()};
+                }
+                pos += n;
+                bytes -= static_cast<std::size_t>(n);
+                offset += static_cast<std::size_t>(n);
+            }
+        }
+
+        auto read_spill(int fd, float* dst, std::size_t bytes, std::size_t offset) -> void
+        {
+            auto pos = reinterpret_cast<unsigned char*>(dst);
+            while(bytes > 0u)
+            {
+                auto n = ::pread(fd, pos, bytes, static_cast<off_t>(offset));
+                if(n == -1)
+                {
+                    if(errno == EINTR)
+                        continue;
+                    throw std::system_error{errno, std::generic_category()};
+                }
+                if(n == 0)
+                    throw std::system_error{EIO, std::generic_category()};
+                pos += n;
+                bytes -= static_cast<std::size_t>(n);
+                offset += static_cast<std::size_t>(n);
+            }
+        }
+
+        template <class State>
+        auto publish(State& s, backend::projection_host_type&& p) -> void
+        {
+            const auto bytes = static_cast<std::size_t>(p.dim_x) * p.dim_y * sizeof(float);
+            auto ptr = std::make_shared<const backend::projection_host_type>(std::move(p));
+            {
+                auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+                auto& slot = s.slots[s.produced];
+                slot.bytes = bytes;
+                slot.dim_x = ptr->dim_x;
+                slot.dim_y = ptr->dim_y;
+                slot.idx = ptr->idx;
+                slot.phi = ptr->phi;
+                slot.projection = std::move(ptr);
+                s.ram_bytes += bytes;
+                ++s.produced;
+            }
+            s.produced_cv.notify_all();
+        }
+
+        // returns false if the stream is shutting down
+        template <class State>
+        auto wait_for_consumers(State& s, std::size_t held) -> bool
+        {
+            auto&& lock = std::unique_lock<std::mutex>{s.mutex};
+            s.consumed_cv.wait(lock, [&s, held]()
+            {
+                return s.stop || s.produced + held < s.leader + s.lookahead;
+            });
+
+            return !s.stop;
+        }
+
+        template <class State>
+        auto write_filtered(State& s, std::size_t n, const backend::projection_host_type& p) -> void
+        {
+            if(s.filtered_path.empty())
+                return;
+
+            try
+            {
+                if(s.writer == nullptr)
+                    s.writer = std::make_unique<pack::writer>(s.filtered_tmp_path, p.dim_x, p.dim_y, s.filtered_type,
+                                                              static_cast<std::uint32_t>(s.slots.size()));
+
+                s.writer->write_frame(static_cast<std::uint32_t>(n), p.buf.get(), p.idx, p.phi);
+
+                if(n + 1u == s.slots.size())
+                {
+                    s.writer->finish(s.has_angles, s.filtered_key);
+                    s.writer.reset();
+                    if(::rename(s.filtered_tmp_path.c_str(), s.filtered_path.c_str()) == -1)
+                        throw std::system_error{errno, std::generic_category()};
+
+                    BOOST_LOG_TRIVIAL(info) << "Stored the filtered projections in " << s.filtered_path;
+                }
+            }
+            catch(const std::system_error& err)
+            {
+                // the cache is an optimization, the reconstruction goes on without it
+                BOOST_LOG_TRIVIAL(warning) << "Could not write the filtered projections to " << s.filtered_path
+                                           << ": " << err.what();
+                s.writer.reset();
+                ::unlink(s.filtered_tmp_path.c_str());
+                s.filtered_path.clear();
+            }
+        }
+
+        template <class State>
+        auto produce(State& s) -> void
+        {
+            try
+            {
+                backend::set_device(s.device);
+
+                // the consumers backproject at the same time, see backend::use_filter_threads()
+                backend::use_filter_threads(s.filter_threads);
+
+                auto n = std::size_t{0};
+                if(s.filtered != nullptr)
+                {
+                    // weighting and filtering were done by an earlier run
+                    for(; n < s.slots.size(); ++n)
+                    {
+                        if(!wait_for_consumers(s, 0u))
+                            return;
+
+                        const auto frame = static_cast<std::uint32_t>(n);
+                        auto p = pack::read_frame(*s.filtered, frame);
+                        p.idx = pack::projection_index(*s.filtered, frame);
+                        p.phi = pack::angle(*s.filtered, frame);
+                        publish(s, std::move(p));
+                    }
+                    return;
+                }
+
+                auto batch = std::vector<backend::projection_device_type>{};
+                batch.reserve(s.batch_size);
+
+                while(!s.src->drained())
+                {
+                    if(!wait_for_consumers(s, batch.size()))
+                        return;
+
+                    auto p = s.src->load_next();
+                    batch.push_back(load(p));
+
+                    if(batch.size() == s.batch_size || s.src->drained())
+                    {
+                        filter(batch, s.det_geo, s.cache_path);
+                        for(auto&& d : batch)
+                        {
+                            auto h = unload(d);
+                            write_filtered(s, n++, h);
+                            publish(s, std::move(h));
+                        }
+                        batch.clear();
+                    }
+                }
+            }
+            catch(...)
+            {
+                {
+                    auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+                    s.error = std::current_exception();
+                }
+                s.produced_cv.notify_all();
+            }
+        }
+    }
+
+    projection_stream::projection_stream(const program_options& po, std::uint32_t consumers, std::size_t cache_size,
+                                         backend::device_handle device)
+    : state_{std::make_unique<state>(po, cache_size, device)}
+    {
+        auto& s = *state_;
+        if(po.enable_filtered_cache)
+        {
+            s.filtered_path = filtered_cache_path(po.input_path);
+            s.filtered_key = make_input_key(po.input_path, po.det_geo, po.quality, po.enable_angles, po.angle_path);
+            if(po.filtered_cache_type == "float16")
+                s.filtered_type = pack::pixel_type::float16;
+
+            if(is_regular_file(s.filtered_path))
+            {
+                s.filtered = pack::open(s.filtered_path);
+                if(s.filtered != nullptr && pack::key(*s.filtered) == s.filtered_key
+                   && pack::type(*s.filtered) == s.filtered_type)
+                {
+                    BOOST_LOG_TRIVIAL(info) << "Reading filtered projections from " << s.filtered_path;
+                    s.has_angles = pack::has_angles(*s.filtered);
+                    s.slots.resize(pack::frame_count(*s.filtered));
+                    s.filtered_path.clear();
+                }
+                else
+                {
+                    BOOST_LOG_TRIVIAL(info) << "The filtered projections in " << s.filtered_path
+                                            << " do not match the input or --filtered-cache-type, they will be "
+                                            << "replaced";
+                    s.filtered.reset();
+                }
+            }
+
+            if(!s.filtered_path.empty())
+                s.filtered_tmp_path = s.filtered_path + ".tmp" + std::to_string(::getpid());
+        }
+
+        if(s.filtered == nullptr)
+        {
+            s.src = std::make_unique<source>(po.input_path, po.enable_angles, po.angle_path, po.quality,
+                                             po.read_ahead);
+            s.has_angles = s.src->has_angles();
+            s.slots.resize(s.src->projection_count());
+        }
+
+        for(auto&& slot : s.slots)
+            slot.pending = consumers;
+
+        s.producer = std::thread{produce<state>, std::ref(s)};
+    }
+
+    projection_stream::~projection_stream()
+    {
+        {
+            auto&& lock = std::lock_guard<std::mutex>{state_->mutex};
+            state_->stop = true;
+        }
+        state_->consumed_cv.notify_all();
+        state_->producer.join();
+
+        // an incomplete filtered projection cache is useless
+        if(state_->writer != nullptr)
+        {
+            state_->writer.reset();
+            ::unlink(state_->filtered_tmp_path.c_str());
+        }
+
+        if(state_->spill_fd != -1)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Spilled " << state_->spill_num << " preprocessed projections ("
+                                    << state_->spill_size / (1024u * 1024u) << " MiB)";
+            ::close(state_->spill_fd);
+        }
+    }
+
+    auto projection_stream::size() const noexcept -> std::size_t
+    {
+        return state_->slots.size();
+    }
+
+    auto projection_stream::has_angles() const noexcept -> bool
+    {
+        return state_->has_angles;
+    }
+
+    auto projection_stream::filtering() const noexcept -> bool
+    {
+        return state_->filtered == nullptr;
+    }
+
+    auto projection_stream::get(std::size_t n) -> value_type
+    {
+        auto& s = *state_;
+        auto p = value_type{};
+        auto& slot = s.slots[n];
+        auto spill = false;
+        auto bytes = std::size_t{};
+        auto offset = std::size_t{};
+        {
+            auto&& lock = std::unique_lock<std::mutex>{s.mutex};
+            if(n >= s.leader)
+            {
+                s.leader = n + 1u;
+                s.consumed_cv.notify_all();
+            }
+
+            s.produced_cv.wait(lock, [&s, n]() { return s.error != nullptr || n < s.produced; });
+            if(s.error != nullptr)
+                std::rethrow_exception(s.error);
+
+            --slot.pending;
+            p = slot.projection;
+            bytes = slot.bytes;
+            offset = slot.offset;
+
+            if(p != nullptr)
+            {
+                if(slot.pending == 0u)
+                {
+                    // everyone has it -> the buffer lives as long as the consumers' references
+                    slot.projection.reset();
+                    s.ram_bytes -= slot.bytes;
+                }
+                else if(s.ram_bytes > s.cache_size && !slot.spilling)
+                {
+                    // a slower consumer will need it later, but the cache is full
+                    if(s.spill_fd == -1)
+                        s.spill_fd = open_spill_file();
+
+                    slot.spilling = true;
+                    slot.offset = s.spill_size;
+                    s.spill_size += slot.bytes;
+                    ++s.spill_num;
+                    offset = slot.offset;
+                    spill = true;
+                }
+            }
+        }
+
+        if(spill)
+        {
+            write_spill(s.spill_fd, p->buf.get(), bytes, offset);
+
+            auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+            slot.spilled = true;
+            if(slot.projection != nullptr)
+            {
+                slot.projection.reset();
+                s.ram_bytes -= slot.bytes;
+            }
+        }
+
+        if(p != nullptr)
+            return p;
+
+        // only spilled projections lose their buffer while a consumer still needs them
+        auto img = backend::make_projection_host(slot.dim_x, slot.dim_y);
+        read_spill(s.spill_fd, img.buf.get(), bytes, offset);
+        img.idx = slot.idx;
+        img.phi = slot.phi;
+        return std::make_shared<const backend::projection_host_type>(std::move(img));
+    }
+}
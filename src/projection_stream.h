@@ -0,0 +1,73 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_PROJECTION_STREAM_H_
+#define PARIS_PROJECTION_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "backend.h"
+#include "program_options.h"
+#include "projection.h"
+
+namespace paris
+{
+    /**
+     * Reads and preprocesses every projection exactly once and hands it to any number of consumers (one per
+     * subvolume). Consumers share reference-counted buffers. The producer stays a few batches ahead of the fastest
+     * consumer. Projections that slower consumers still need stay in memory up to cache_size bytes, the rest is
+     * spilled to a temporary file.
+     *
+     * With po.enable_filtered_cache the preprocessed projections are also stored next to the input. Later runs with
+     * the same input, geometry, quality and angles read them from there and skip decoding, weighting and filtering.
+     */
+    class projection_stream
+    {
+        public:
+            using value_type = std::shared_ptr<const backend::projection_host_type>;
+
+            projection_stream(const program_options& po, std::uint32_t consumers, std::size_t cache_size,
+                              backend::device_handle device);
+            ~projection_stream();
+
+            projection_stream(const projection_stream&) = delete;
+            auto operator=(const projection_stream&) -> projection_stream& = delete;
+
+            // number of projections every consumer receives
+            auto size() const noexcept -> std::size_t;
+            auto has_angles() const noexcept -> bool;
+
+            // false if the projections come from the filtered projection cache
+            auto filtering() const noexcept -> bool;
+
+            // blocks until projection n is preprocessed, each consumer must fetch all projections in order
+            auto get(std::size_t n) -> value_type;
+
+        private:
+            struct state;
+            std::unique_ptr<state> state_;
+    };
+}
+
+#endif /* PARIS_PROJECTION_STREAM_H_ */
@@ -0,0 +1,191 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "backend.h"
+#include "compression.h"
+#include "ddbvf.h"
+#include "geometry.h"
+#include "pyramid.h"
+
+namespace paris
+{
+    namespace
+    {
+        auto reduce(std::uint32_t dim) noexcept -> std::uint32_t
+        {
+            return (dim + 1u) / 2u;
+        }
+
+        // sums 2x2 blocks of src, blocks on the right and lower edge may be incomplete
+        auto pool(const float* src, std::uint32_t w, std::uint32_t h, float* dest) noexcept -> void
+        {
+            const auto rw = reduce(w);
+            for(auto y = 0u; y < h; y += 2u)
+            {
+                const auto row0 = src + std::size_t{y} * w;
+                const auto row1 = y + 1u < h ? row0 + w : nullptr;
+                const auto out = dest + std::size_t{y / 2u} * rw;
+
+                for(auto x = 0u; x < w / 2u; ++x)
+                {
+                    auto s = row0[2u * x] + row0[2u * x + 1u];
+                    if(row1 != nullptr)
+                        s += row1[2u * x] + row1[2u * x + 1u];
+                    out[x] = s;
+                }
+
+                if(w % 2u != 0u)
+                    out[rw - 1u] = row0[w - 1u] + (row1 != nullptr ? row1[w - 1u] : 0.f);
+            }
+        }
+
+        // number of source voxels of pooled voxel i along an axis
+        auto extent(std::uint32_t dim, std::uint32_t factor, std::uint32_t i) noexcept -> std::uint32_t
+        {
+            return std::min(factor, dim - i * factor);
+        }
+    }
+
+    pyramid::pyramid(const std::string& path, const volume_geometry& vol_geo, std::uint16_t levels,
+                     compression::codec codec, std::uint32_t chunk_size, ddbvf::element_type type)
+    : vol_geo_(vol_geo)
+    {
+        auto dim_x = vol_geo.dim_x;
+        auto dim_y = vol_geo.dim_y;
+        auto dim_z = vol_geo.dim_z;
+        auto factor = 1u;
+        for(auto l = 0u; l < levels; ++l)
+        {
+            dim_x = reduce(dim_x);
+            dim_y = reduce(dim_y);
+            dim_z = reduce(dim_z);
+            factor *= 2u;
+
+            auto lvl = level{};
+            lvl.handle = ddbvf::create(path + "_" + std::to_string(factor) + "x", dim_x, dim_y, dim_z, false, codec,
+                                       chunk_size, type);
+            lvl.factor = factor;
+            lvl.dim_x = dim_x;
+            lvl.dim_y = dim_y;
+            lvl.dim_z = dim_z;
+            levels_.push_back(std::move(lvl));
+        }
+    }
+
+    auto pyramid::set_window(float min, float max) -> void
+    {
+        for(auto&& l : levels_)
+            ddbvf::set_window(l.handle, min, max);
+    }
+
+    auto pyramid::add(const backend::volume_host_type& v) -> void
+    {
+        if(levels_.empty())
+            return;
+
+        // each level pools the one before it in x and y, z is summed up per pooled slice
+        auto sums = std::vector<std::vector<float>>(levels_.size());
+        for(auto i = std::size_t{0}; i < levels_.size(); ++i)
+            sums[i].resize(std::size_t{levels_[i].dim_x} * levels_[i].dim_y);
+
+        const auto slice_size = std::size_t{v.dim_x} * v.dim_y;
+        for(auto z = 0u; z < v.dim_z; ++z)
+        {
+            const auto slice_z = v.off + z;
+            auto src = v.buf.get() + z * slice_size;
+            auto w = v.dim_x;
+            auto h = v.dim_y;
+            for(auto i = std::size_t{0}; i < levels_.size(); ++i)
+            {
+                auto& l = levels_[i];
+                pool(src, w, h, sums[i].data());
+                accumulate(l, slice_z / l.factor, sums[i]);
+
+                src = sums[i].data();
+                w = l.dim_x;
+                h = l.dim_y;
+            }
+        }
+    }
+
+    auto pyramid::accumulate(level& l, std::uint32_t z, const std::vector<float>& sum) -> void
+    {
+        const auto expected = extent(vol_geo_.dim_z, l.factor, z);
+
+        auto complete = std::vector<float>{};
+        {
+            auto&& lock = std::lock_guard<std::mutex>{mutex_};
+            auto& p = l.partial[z];
+            if(p.sum.empty())
+                p.sum = sum;
+            else
+                std::transform(std::begin(p.sum), std::end(p.sum), std::begin(sum), std::begin(p.sum),
+                               [](float a, float b) { return a + b; });
+
+            if(++p.slices < expected)
+                return;
+
+            complete = std::move(p.sum);
+            l.partial.erase(z);
+        }
+
+        write(l, z, complete);
+    }
+
+    auto pyramid::write(const level& l, std::uint32_t z, const std::vector<float>& sum) -> void
+    {
+        const auto depth = extent(vol_geo_.dim_z, l.factor, z);
+
+        auto v = backend::make_volume_host(l.dim_x, l.dim_y, 1u);
+        for(auto y = 0u; y < l.dim_y; ++y)
+        {
+            const auto rows = extent(vol_geo_.dim_y, l.factor, y) * depth;
+            for(auto x = 0u; x < l.dim_x; ++x)
+            {
+                const auto i = std::size_t{y} * l.dim_x + x;
+                v.buf[i] = sum[i] / static_cast<float>(extent(vol_geo_.dim_x, l.factor, x) * rows);
+            }
+        }
+
+        ddbvf::write(l.handle, v, z);
+    }
+
+    auto pyramid::finish() -> void
+    {
+        for(auto&& l : levels_)
+        {
+            if(!l.partial.empty())
+                throw std::runtime_error{"pyramid::finish(): volume is incomplete"};
+
+            ddbvf::finish(l.handle);
+        }
+    }
+}
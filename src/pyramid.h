@@ -0,0 +1,89 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_PYRAMID_H_
+#define PARIS_PYRAMID_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "backend.h"
+#include "compression.h"
+#include "ddbvf.h"
+#include "geometry.h"
+
+namespace paris
+{
+    /**
+     * Mean-pooled levels of a volume, level l is reduced by 2^l in every direction and written to <path>_<2^l>x in
+     * the format of the volume. Subvolumes are added as they are saved, in any order. A pooled slice is written as
+     * soon as all of its source slices were added, so only slices on subvolume boundaries are kept in memory.
+     */
+    class pyramid
+    {
+        public:
+            pyramid(const std::string& path, const volume_geometry& vol_geo, std::uint16_t levels,
+                    compression::codec codec, std::uint32_t chunk_size, ddbvf::element_type type);
+
+            pyramid(const pyramid&) = delete;
+            auto operator=(const pyramid&) -> pyramid& = delete;
+
+            auto set_window(float min, float max) -> void;
+
+            // thread-safe, subvolumes must cover disjoint slices
+            auto add(const backend::volume_host_type& v) -> void;
+
+            // completes the level files after all subvolumes were added
+            auto finish() -> void;
+
+        private:
+            // sums of a pooled slice that misses some of its source slices
+            struct partial_slice
+            {
+                std::vector<float> sum;
+                std::uint32_t slices;
+            };
+
+            struct level
+            {
+                ddbvf::handle_type handle;
+                std::uint32_t factor;
+                std::uint32_t dim_x;
+                std::uint32_t dim_y;
+                std::uint32_t dim_z;
+                std::map<std::uint32_t, partial_slice> partial;
+            };
+
+            auto accumulate(level& l, std::uint32_t z, const std::vector<float>& sum) -> void;
+            auto write(const level& l, std::uint32_t z, const std::vector<float>& sum) -> void;
+
+        private:
+            volume_geometry vol_geo_;
+            std::vector<level> levels_;
+            std::mutex mutex_;
+    };
+}
+
+#endif /* PARIS_PYRAMID_H_ */
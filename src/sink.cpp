@@ -20,39 +20,170 @@
  * Authors: Jan Stephan <j.stephan@hzdr.de>
  */
 
+#include <algorithm>
 #include <cstddef>
-#include <stdexcept>
+#include <cstdint>
+#include <exception>
 #include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
 #include <utility>
 
 #include <boost/log/trivial.hpp>
 
 #include "backend.h"
+#include "compression.h"
 #include "exception.h"
 #include "filesystem.h"
+#include "make_volume.h"
+#include "program_options.h"
+#include "pyramid.h"
 #include "sink.h"
 #include "ddbvf.h"
+#include "value_range.h"
 #include "volume.h"
 
 namespace paris
 {
-    sink::sink(const std::string& path, const std::string& prefix, const volume_geometry& vol_geo)
-    : path_{path}, vol_geo_(vol_geo)
+    namespace
+    {
+        // percentiles of the volume, widened a little so the tails are not clipped
+        constexpr auto window_lower = 0.001;
+        constexpr auto window_upper = 0.999;
+        constexpr auto window_margin = 0.1;
+
+        auto to_element_type(const std::string& name) -> ddbvf::element_type
+        {
+            if(name == "uint16")
+                return ddbvf::element_type::uint16;
+            if(name == "float16")
+                return ddbvf::element_type::float16;
+            return ddbvf::element_type::float32;
+        }
+
+        // the OpenMP backend computes in host memory -> volumes are handed to the writers without copying
+        using zero_copy = std::is_same<backend::volume_host_type, backend::volume_device_type>;
+
+        auto matches(const backend::volume_host_type& v, std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept
+            -> bool
+        {
+            return v.dim_x == x && v.dim_y == y && v.dim_z == z;
+        }
+
+        auto take_buffer(std::vector<backend::volume_host_type>& pool, std::uint32_t x, std::uint32_t y,
+                         std::uint32_t z) -> backend::volume_host_type
+        {
+            auto it = std::find_if(std::begin(pool), std::end(pool),
+                                   [x, y, z](const backend::volume_host_type& v) { return matches(v, x, y, z); });
+            if(it == std::end(pool))
+                return backend::volume_host_type{};
+
+            auto v = std::move(*it);
+            pool.erase(it);
+            return v;
+        }
+
+        template <class Volume>
+        auto stage(Volume&& v, std::vector<backend::volume_host_type>&, std::mutex&, std::true_type)
+            -> backend::volume_host_type
+        {
+            return std::move(v);
+        }
+
+        // other backends copy into a recycled host buffer, pinned host memory is expensive to allocate
+        template <class Volume>
+        auto stage(Volume&& v, std::vector<backend::volume_host_type>& pool, std::mutex& m, std::false_type)
+            -> backend::volume_host_type
+        {
+            auto host_v = backend::volume_host_type{};
+            {
+                auto&& lock = std::lock_guard<std::mutex>{m};
+                host_v = take_buffer(pool, v.dim_x, v.dim_y, v.dim_z);
+            }
+
+            if(host_v.buf == nullptr)
+                host_v = backend::make_volume_host(v.dim_x, v.dim_y, v.dim_z);
+
+            backend::copy_d2h(v, host_v);
+            host_v.off = v.off;
+            return host_v;
+        }
+
+        template <class Pool>
+        auto recycle(Pool& pool, std::mutex& m, std::uint32_t x, std::uint32_t y, std::uint32_t z, std::true_type)
+            -> backend::volume_device_type
+        {
+            auto v = backend::volume_host_type{};
+            auto stale = Pool{};
+            {
+                auto&& lock = std::lock_guard<std::mutex>{m};
+                v = take_buffer(pool, x, y, z);
+
+                // the pooled buffers have the wrong size (the last subvolume is taller), free them before the caller
+                // allocates a new one
+                if(v.buf == nullptr)
+                    stale.swap(pool);
+            }
+
+            if(v.buf != nullptr)
+            {
+                std::fill_n(v.buf.get(), std::size_t{x} * y * z, 0.f);
+                v.off = 0u;
+            }
+            return v;
+        }
+
+        // device memory is managed by the backend
+        template <class Pool>
+        auto recycle(Pool&, std::mutex&, std::uint32_t, std::uint32_t, std::uint32_t, std::false_type)
+            -> backend::volume_device_type
+        {
+            return backend::volume_device_type{};
+        }
+    }
+
+    sink::sink(const program_options& po, const volume_geometry& vol_geo, int subvolumes)
+    : path_{po.output_path}, prefix_{po.prefix}, vol_geo_(vol_geo), type_{to_element_type(po.output_type)}
+    , window_set_{false}, range_{}, max_in_flight_{po.write_behind}, in_flight_{0u}, stop_{false}
     {
+        // subvolumes arrive one by one, the window has to be known before the first one is written
+        if(type_ == ddbvf::element_type::uint16 && !po.enable_window && subvolumes > 1)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "sink::sink(): the volume is reconstructed in " << subvolumes
+                                     << " subvolumes, uint16 output needs --window-min and --window-max";
+            throw stage_construction_error{"sink::sink() failed"};
+        }
+
         try
         {
             if(path_.back() != '/')
                 path_ += '/';
-            path_ += prefix;
+            path_ += prefix_;
 
-            auto s = create_directory(path);
+            auto s = create_directory(po.output_path);
             if(!s)
             {
-                BOOST_LOG_TRIVIAL(fatal) << "sink::sink() failed to create output directory at " << path;
+                BOOST_LOG_TRIVIAL(fatal) << "sink::sink() failed to create output directory at " << po.output_path;
                 throw stage_construction_error{"sink::sink() failed"};
             }
 
-            handle_ = ddbvf::create(path_, vol_geo_.dim_x, vol_geo_.dim_y, vol_geo_.dim_z);
+            const auto codec = compression::from_string(po.compression);
+            handle_ = ddbvf::create(path_, vol_geo_.dim_x, vol_geo_.dim_y, vol_geo_.dim_z, po.direct_io, codec,
+                                    po.chunk_size, type_);
+
+            if(po.pyramid_levels > 0u)
+                pyramid_.reset(new pyramid{path_, vol_geo_, po.pyramid_levels, codec, po.chunk_size, type_});
+
+            if(type_ == ddbvf::element_type::uint16 && po.enable_window)
+            {
+                ddbvf::set_window(handle_, po.window_min, po.window_max);
+                if(pyramid_ != nullptr)
+                    pyramid_->set_window(po.window_min, po.window_max);
+                window_ = std::make_pair(po.window_min, po.window_max);
+                window_set_ = true;
+            }
         }
         catch(const std::system_error& se)
         {
@@ -69,16 +200,194 @@ namespace paris
 
     }
 
-    auto sink::save(const backend::volume_device_type& v) -> void
+    sink::~sink()
+    {
+        {
+            auto&& lock = std::lock_guard<std::mutex>{mutex_};
+            stop_ = true;
+        }
+        queued_.notify_all();
+
+        // the writers finish the queue before they exit
+        for(auto&& t : writers_)
+            t.join();
+    }
+
+    auto sink::make_volume(const subvolume_geometry& subvol_geo, bool last) -> backend::volume_device_type
     {
+        auto dim_z = subvol_geo.dim_z;
+        if(last)
+            dim_z += subvol_geo.remainder;
+
+        auto v = recycle(free_, mutex_, subvol_geo.dim_x, subvol_geo.dim_y, dim_z, zero_copy{});
+        if(v.buf == nullptr)
+            return paris::make_volume(subvol_geo, last);
+
+        return v;
+    }
+
+    auto sink::save(backend::volume_device_type&& v) -> void
+    {
+        auto host_v = stage(std::move(v), free_, mutex_, zero_copy{});
+
+        if(max_in_flight_ == 0u)
+        {
+            write(host_v);
+            release(std::move(host_v));
+            return;
+        }
+
+        {
+            auto&& lock = std::unique_lock<std::mutex>{mutex_};
+            written_.wait(lock, [this]() { return in_flight_ < max_in_flight_ || error_ != nullptr; });
+            if(error_ != nullptr)
+                std::rethrow_exception(error_);
+
+            if(writers_.empty())
+            {
+                for(auto i = std::size_t{0}; i < max_in_flight_; ++i)
+                    writers_.emplace_back(&sink::run, this);
+            }
+
+            ++in_flight_;
+            queue_.push_back(std::move(host_v));
+        }
+        queued_.notify_one();
+    }
+
+    auto sink::observe(const backend::volume_host_type& v) -> void
+    {
+        if(type_ != ddbvf::element_type::uint16)
+            return;
+
+        const auto n = std::size_t{v.dim_x} * v.dim_y * v.dim_z;
+        auto window = std::pair<float, float>{};
+        {
+            // without a user window the volume is a single subvolume
+            auto&& lock = std::lock_guard<std::mutex>{range_mutex_};
+            if(!window_set_)
+            {
+                window_ = estimate_window(v.buf.get(), n, window_lower, window_upper, window_margin);
+                BOOST_LOG_TRIVIAL(info) << "uint16 window estimated from the volume: [" << window_.first
+                                        << ", " << window_.second << "]";
+                try
+                {
+                    ddbvf::set_window(handle_, window_.first, window_.second);
+                    if(pyramid_ != nullptr)
+                        pyramid_->set_window(window_.first, window_.second);
+                }
+                catch(const std::system_error& se)
+                {
+                    BOOST_LOG_TRIVIAL(fatal) << "sink::save(): system error while saving volume: "
+                                                << se.code() << " - " << se.what();
+                    throw stage_runtime_error{"sink::save() failed"};
+                }
+                window_set_ = true;
+            }
+            window = window_;
+        }
+
+        const auto r = measure(v.buf.get(), n, window.first, window.second);
+
+        auto&& lock = std::lock_guard<std::mutex>{range_mutex_};
+        range_ = range_.count == 0u ? r : merge(range_, r);
+    }
+
+    auto sink::flush() -> void
+    {
+        auto&& lock = std::unique_lock<std::mutex>{mutex_};
+        written_.wait(lock, [this]() { return in_flight_ == 0u; });
+        if(error_ != nullptr)
+            std::rethrow_exception(error_);
+
+        if(type_ == ddbvf::element_type::uint16 && range_.count > 0u)
+        {
+            const auto percent = 100.0 * static_cast<double>(range_.clipped) / static_cast<double>(range_.count);
+            BOOST_LOG_TRIVIAL(info) << "Volume range [" << range_.min << ", " << range_.max << "], "
+                                    << range_.clipped << " voxels (" << percent << " %) outside the uint16 window ["
+                                    << window_.first << ", " << window_.second << "]";
+            if(range_.clipped > 0u)
+                BOOST_LOG_TRIVIAL(warning) << "Some voxels were clipped, pass --window-min and --window-max to "
+                                              "widen the uint16 window";
+        }
+
         try
         {
-            auto host_v = backend::make_volume_host(v.dim_x, v.dim_y, v.dim_z);
-            backend::copy_d2h(v, host_v);
+            ddbvf::finish(handle_);
+            if(pyramid_ != nullptr)
+                pyramid_->finish();
+        }
+        catch(const std::system_error& se)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "sink::flush(): system error while completing volume: "
+                                        << se.code() << " - " << se.what();
+            throw stage_runtime_error{"sink::flush() failed"};
+        }
+        catch(const std::runtime_error& re)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "sink::flush(): runtime error while completing volume: " << re.what();
+            throw stage_runtime_error{"sink::flush() failed"};
+        }
+    }
+
+    auto sink::run() -> void
+    {
+        while(true)
+        {
+            auto v = backend::volume_host_type{};
+            {
+                auto&& lock = std::unique_lock<std::mutex>{mutex_};
+                queued_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+                if(queue_.empty())
+                    return;
+
+                v = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            auto err = std::exception_ptr{};
+            try
+            {
+                write(v);
+            }
+            catch(...)
+            {
+                err = std::current_exception();
+            }
+
+            {
+                auto&& lock = std::lock_guard<std::mutex>{mutex_};
+                if(err != nullptr && error_ == nullptr)
+                    error_ = err;
+                --in_flight_;
+            }
+            release(std::move(v));
+            written_.notify_all();
+        }
+    }
+
+    auto sink::release(backend::volume_host_type&& v) -> void
+    {
+        /* The memory budget allows for the subvolume being computed plus max_in_flight_ written ones. Pool a buffer
+         * only if that still leaves room for the one the compute thread holds, free it otherwise. */
+        auto&& lock = std::lock_guard<std::mutex>{mutex_};
+        if(in_flight_ + free_.size() < std::max<std::size_t>(max_in_flight_, 1u))
+            free_.push_back(std::move(v));
+    }
+
+    auto sink::write(const backend::volume_host_type& v) -> void
+    {
+        // on the writer threads, so the extra pass over the voxels overlaps with the next subvolume
+        observe(v);
+
+        try
+        {
+            // subvolumes cover disjoint slices -> no locking needed
+            ddbvf::write(handle_, v, v.off);
 
-            static auto&& m = std::mutex{};
-            auto&& lock = std::lock_guard<std::mutex>{m};
-            ddbvf::write(handle_, host_v, host_v.off);
+            // the pooled levels are built from the slices while they are still in memory
+            if(pyramid_ != nullptr)
+                pyramid_->add(v);
         }
         catch(const std::system_error& se)
         {
@@ -23,27 +23,85 @@
 #ifndef PARIS_SINK_H_
 #define PARIS_SINK_H_
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "backend.h"
 #include "ddbvf.h"
 #include "geometry.h"
+#include "program_options.h"
+#include "pyramid.h"
+#include "value_range.h"
 #include "volume.h"
 
 namespace paris
 {
+    /**
+     * Writes subvolumes to the output file in the background. save() takes over the volume and returns as soon as
+     * one of write_behind writer threads is free, so the compute thread can start on the next subvolume while the
+     * previous one is written. write_behind = 0 writes synchronously. Voxels are converted to the output type
+     * while writing. Without a user window, uint16 volumes use a window estimated from the volume, which therefore
+     * has to be reconstructed in one piece. Pooled levels of the volume are built from the subvolumes as they are
+     * written.
+     */
     class sink
     {
         public:
-            sink(const std::string& path, const std::string& prefix, const volume_geometry& vol_geo);
-            auto save(const backend::volume_device_type& v) -> void;
+            sink(const program_options& po, const volume_geometry& vol_geo, int subvolumes);
+            ~sink();
+
+            sink(const sink&) = delete;
+            auto operator=(const sink&) -> sink& = delete;
+
+            // a zeroed subvolume, reuses the buffer of an already written subvolume where possible
+            auto make_volume(const subvolume_geometry& subvol_geo, bool last) -> backend::volume_device_type;
+
+            auto save(backend::volume_device_type&& v) -> void;
+
+            // waits until all subvolumes are written and completes the file, rethrows the first write error
+            auto flush() -> void;
+
+        private:
+            auto observe(const backend::volume_host_type& v) -> void;
+            auto write(const backend::volume_host_type& v) -> void;
+            auto release(backend::volume_host_type&& v) -> void;
+            auto run() -> void;
 
         private:
             std::string path_;
             std::string prefix_;
             ddbvf::handle_type handle_;
+            std::unique_ptr<pyramid> pyramid_;     // nullptr without pooled levels
 
             volume_geometry vol_geo_;
+
+            // uint16 output: window and range of the values written so far
+            ddbvf::element_type type_;
+            bool window_set_;
+            std::pair<float, float> window_;
+            value_range range_;
+            std::mutex range_mutex_;
+
+            std::size_t max_in_flight_;
+            std::size_t in_flight_;
+            std::deque<backend::volume_host_type> queue_;
+            std::vector<backend::volume_host_type> free_;    // written buffers kept for reuse
+            std::exception_ptr error_;
+            bool stop_;
+
+            std::mutex mutex_;
+            std::condition_variable queued_;
+            std::condition_variable written_;
+            std::vector<std::thread> writers_;
     };
 }
 
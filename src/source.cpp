@@ -21,9 +21,16 @@
  */
 
 #include <algorithm>
-#include <fstream>
-#include <iterator>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -32,105 +39,295 @@
 #include "backend.h"
 #include "exception.h"
 #include "filesystem.h"
+#include "frame_index.h"
 #include "his.h"
+#include "pack.h"
 #include "projection.h"
 #include "source.h"
 
 namespace paris
 {
+    struct source::state
+    {
+        // projections of one file, decoded by a loader
+        struct block
+        {
+            std::vector<output_type> projections;
+            std::exception_ptr error;
+        };
+
+        // [begin, end) of selected, all entries belong to the same file
+        struct range
+        {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        frame_index index;
+        std::vector<std::size_t> selected;  // positions in index.frames chosen by --quality
+        std::vector<range> blocks;
+        std::size_t blocks_in_flight;
+
+        std::mutex mutex;
+        std::condition_variable block_loaded;
+        std::condition_variable block_consumed;
+
+        // decoded blocks waiting for the consumer, by block number
+        std::map<std::size_t, block> loaded;
+        std::size_t next_block = 0;     // next block to be claimed by a loader
+        std::size_t consumed = 0;       // number of blocks handed to the consumer
+        bool stop = false;
+
+        // files currently mapped by any loader -> consecutive blocks share the mapping
+        std::map<std::uint32_t, std::weak_ptr<his::handle>> files;
+
+        // projection container, mapped once and shared by all loaders
+        pack::handle_type packed;
+
+        std::vector<std::thread> loaders;
+    };
+
     namespace
     {
-        auto read_angles(const std::string& path) -> std::vector<float>
+        // number of frames decoded by a loader in one go
+        constexpr auto frames_per_block = 8u;
+
+        // decoded blocks a source keeps ahead of its consumer
+        auto blocks_in_flight(std::uint16_t read_ahead) noexcept -> std::size_t
         {
-            auto angles = std::vector<float>{};
+            return std::max<std::size_t>((read_ahead + frames_per_block - 1u) / frames_per_block, 1u);
+        }
+
+        template <class State>
+        auto make_blocks(State& s) -> void
+        {
+            for(auto i = std::size_t{0}; i < s.selected.size();)
+            {
+                const auto file = s.index.frames[s.selected[i]].file;
+                auto end = i + 1u;
+                while(end < s.selected.size() && end - i < frames_per_block
+                      && s.index.frames[s.selected[end]].file == file)
+                    ++end;
+
+                s.blocks.push_back(typename State::range{i, end});
+                i = end;
+            }
+        }
 
-            auto&& file = std::ifstream{path.c_str()};
-            if(!file.is_open())
+        template <class State>
+        auto open_file(State& s, std::uint32_t file) -> std::shared_ptr<his::handle>
+        {
             {
-                BOOST_LOG_TRIVIAL(warning) << "Could not open angle file at " << path << ", using default values.";
-                return angles;
+                auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+                auto h = s.files[file].lock();
+                if(h != nullptr)
+                    return h;
             }
 
-            auto angle_string = std::string{};
-            std::getline(file, angle_string);
+            // several loaders may open the same file at once, each of them gets a valid mapping
+            auto h = std::shared_ptr<his::handle>{his::open(s.index.paths[file])};
+            if(h == nullptr)
+            {
+                BOOST_LOG_TRIVIAL(fatal) << s.index.paths[file] << " changed after indexing";
+                throw stage_runtime_error{"source: invalid file"};
+            }
 
-            auto loc = std::locale{};
-            if(angle_string.find(',') != std::string::npos)
-                loc = std::locale{"de_DE.UTF-8"};
+            auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+            s.files[file] = h;
+            return h;
+        }
 
-            file.seekg(0, std::ios_base::beg);
-            file.imbue(loc);
+        // Handle is his::handle or pack::handle, prefetch() and read_frame() are found in its namespace
+        template <class State, class Handle>
+        auto decode_block(const State& s, std::size_t n, const Handle& h, typename State::block& b) -> void
+        {
+            const auto& r = s.blocks[n];
+            const auto file = s.index.frames[s.selected[r.begin]].file;
 
-            while(!file.eof())
+            // the next loader will most likely need the following block
+            if(n + 1 < s.blocks.size())
             {
-                auto angle = 0.f;
-                file >> angle;
-                angles.push_back(angle);
+                const auto& next = s.blocks[n + 1];
+                for(auto k = next.begin; k < next.end; ++k)
+                {
+                    const auto& e = s.index.frames[s.selected[k]];
+                    if(e.file == file)
+                        prefetch(h, e.frame, 1u);
+                }
+            }
+
+            b.projections.reserve(r.end - r.begin);
+            for(auto k = r.begin; k < r.end; ++k)
+            {
+                const auto& e = s.index.frames[s.selected[k]];
+                auto p = read_frame(h, e.frame);
+                p.idx = e.idx;
+                p.phi = e.phi;
+                b.projections.push_back(std::move(p));
             }
+        }
+
+        template <class State>
+        auto load_blocks(State& s) -> void
+        {
+            while(true)
+            {
+                auto n = std::size_t{};
+                {
+                    auto&& lock = std::unique_lock<std::mutex>{s.mutex};
+                    s.block_consumed.wait(lock, [&s]()
+                    {
+                        return s.stop || s.next_block >= s.blocks.size()
+                               || s.next_block < s.consumed + s.blocks_in_flight;
+                    });
+
+                    if(s.stop || s.next_block >= s.blocks.size())
+                        return;
 
-            return angles;
+                    n = s.next_block++;
+                }
+
+                const auto file = s.index.frames[s.selected[s.blocks[n].begin]].file;
+
+                auto b = typename State::block{};
+                try
+                {
+                    if(s.packed != nullptr)
+                        decode_block(s, n, *s.packed, b);
+                    else
+                        decode_block(s, n, *open_file(s, file), b);
+                }
+                catch(...)
+                {
+                    b.error = std::current_exception();
+                }
+
+                {
+                    auto&& lock = std::lock_guard<std::mutex>{s.mutex};
+                    s.loaded.emplace(n, std::move(b));
+                }
+                s.block_loaded.notify_all();
+            }
         }
     }
 
     source::source(const std::string& proj_dir,
                    bool enable_angles, const std::string& angle_file,
-                   std::uint16_t quality) noexcept
-    : drained_{true}, enable_angles_{enable_angles}, quality_{quality}
+                   std::uint16_t quality, std::uint16_t read_ahead)
+    : state_{std::make_unique<state>()}, remaining_{0u}
     {
-        paths_ = read_directory(proj_dir);
-        if(!paths_.empty())
-            drained_ = false;
+        auto angles = std::vector<float>{};
+        if(enable_angles)
+            angles = read_angles(angle_file);
 
-        if(enable_angles_)
-            angles_ = read_angles(angle_file);
+        auto& s = *state_;
+        if(is_regular_file(proj_dir))
+        {
+            s.packed = pack::open(proj_dir);
+            if(s.packed == nullptr)
+            {
+                BOOST_LOG_TRIVIAL(fatal) << proj_dir << " is neither a directory nor a projection container";
+                throw stage_construction_error{"source: invalid input"};
+            }
+            s.index = make_frame_index(proj_dir, *s.packed, angles);
+        }
+        else
+            s.index = make_frame_index(read_directory(proj_dir), angles);
+
+        // with --quality only every quality-th projection is used, the others are never read
+        const auto q = std::max<std::uint32_t>(quality, 1u);
+        for(auto i = std::size_t{0}; i < s.index.frames.size(); ++i)
+        {
+            if(s.index.frames[i].idx % q == 0u)
+                s.selected.push_back(i);
+        }
+        remaining_ = s.selected.size();
+
+        make_blocks(s);
+        s.blocks_in_flight = blocks_in_flight(read_ahead);
+
+        // one loader per block in flight -> blocks are decoded in parallel
+        const auto loader_num = std::min(s.blocks_in_flight, s.blocks.size());
+        for(auto n = 0u; n < loader_num; ++n)
+            s.loaders.emplace_back(load_blocks<state>, std::ref(s));
     }
 
-    auto source::load_next() -> output_type
+    source::source(source&& other) noexcept = default;
+
+    source::~source()
     {
-        thread_local static auto i = 0u;
-        if(queue_.empty())
+        if(state_ == nullptr)
+            return;
+
         {
-            auto done = false;
-            while(!done)
-            {
-                auto vec = his::load(paths_[0u]);
-                if(vec.empty())
-                {
-                    BOOST_LOG_TRIVIAL(warning) << "Skipping invalid file at " << paths_[0u];
-                }
-                else
-                {
-                    for(auto&& p : vec)
-                    {
-                        if(i % quality_ == 0u)
-                        {
-                            p.idx = i;
-
-                            if(enable_angles_ && !angles_.empty())
-                                p.phi = angles_[i];
-
-                            queue_.push(std::move(p));
-                        }
-                        ++i;
-                    }
-                    done = true;
-                }
+            auto&& lock = std::lock_guard<std::mutex>{state_->mutex};
+            state_->stop = true;
+        }
+        state_->block_consumed.notify_all();
 
-                paths_.erase(std::begin(paths_));
-            }
+        for(auto&& t : state_->loaders)
+            t.join();
+    }
+
+    // moves the projections of the next block into the queue
+    auto source::fetch() -> void
+    {
+        auto& s = *state_;
+        auto b = state::block{};
+        {
+            auto&& lock = std::unique_lock<std::mutex>{s.mutex};
+            s.block_loaded.wait(lock, [&s]() { return s.loaded.count(s.consumed) != 0; });
+
+            auto it = s.loaded.find(s.consumed);
+            b = std::move(it->second);
+            s.loaded.erase(it);
+            ++s.consumed;
+        }
+        s.block_consumed.notify_all();
+
+        if(b.error != nullptr)
+            std::rethrow_exception(b.error);
+
+        for(auto&& p : b.projections)
+            queue_.push(std::move(p));
+    }
+
+    auto source::load_next() -> output_type
+    {
+        if(remaining_ == 0u)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "source::load_next(): no more projections available";
+            throw stage_runtime_error{"source::load_next() failed"};
         }
 
+        if(queue_.empty())
+            fetch();
+
         auto p = std::move(queue_.front());
         queue_.pop();
-
-        if(paths_.empty() && queue_.empty())
-            drained_ = true;
+        --remaining_;
 
         return p;
     }
 
     auto source::drained() const noexcept -> bool
     {
-        return drained_;
+        return remaining_ == 0u;
+    }
+
+    auto source::has_angles() const noexcept -> bool
+    {
+        return state_->index.has_angles;
+    }
+
+    auto source::projection_count() const noexcept -> std::size_t
+    {
+        return state_->selected.size();
+    }
+
+    auto source::max_buffered(std::uint16_t read_ahead) noexcept -> std::size_t
+    {
+        // the blocks claimed by the loaders plus the one queued for the consumer
+        return (blocks_in_flight(read_ahead) + 1u) * frames_per_block;
     }
 }
@@ -23,7 +23,9 @@
 #ifndef PARIS_SOURCE_H_
 #define PARIS_SOURCE_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <queue>
 #include <vector>
@@ -33,28 +35,46 @@
 
 namespace paris
 {
+    /**
+     * Reads the projections of a directory or a projection container (see pack.h) in order. All file headers are
+     * indexed up front, then a pool of loader threads decodes about read_ahead projections ahead of the consumer, so
+     * disk I/O overlaps with preprocessing and backprojection. Multi-frame files are read in small blocks of frames,
+     * memory use does not depend on the file size.
+     */
     class source
     {
         private:
             using output_type = backend::projection_host_type;
+            struct state;
 
         public:
             source(const std::string& proj_dir,
                    bool enable_angles = false,
                    const std::string& angle_file = "",
-                   std::uint16_t quality = 1) noexcept;
+                   std::uint16_t quality = 1,
+                   std::uint16_t read_ahead = 4);
+            source(source&& other) noexcept;
+            ~source();
 
             auto load_next() -> output_type;
             auto drained() const noexcept -> bool;
 
+            // true if the angles come from an angle file or the projection container
+            auto has_angles() const noexcept -> bool;
+
+            // number of projections this source delivers in total
+            auto projection_count() const noexcept -> std::size_t;
+
+            // upper bound for the decoded projections a source with this read_ahead holds at any time
+            static auto max_buffered(std::uint16_t read_ahead) noexcept -> std::size_t;
+
+        private:
+            auto fetch() -> void;
+
         private:
-            std::vector<std::string> paths_;
+            std::unique_ptr<state> state_;
             std::queue<output_type> queue_;
-            bool drained_;
-            
-            bool enable_angles_;
-            std::vector<float> angles_;
-            std::uint16_t quality_;
+            std::size_t remaining_;
     };
 }
 
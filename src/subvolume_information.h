@@ -23,6 +23,8 @@
 #ifndef PARIS_SUBVOLUME_INFORMATION_H_
 #define PARIS_SUBVOLUME_INFORMATION_H_
 
+#include <cstddef>
+
 #include "geometry.h"
 
 namespace paris
@@ -31,6 +33,9 @@ namespace paris
     {
         subvolume_geometry geo;
         int num;
+
+        // bytes of preprocessed projections kept in memory for the subvolumes that need them later
+        std::size_t projection_cache;
     };
 }
 
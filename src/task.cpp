@@ -44,7 +44,7 @@ namespace paris
                             po.det_geo, vol_geo, subvol_geo,
                             po.enable_roi, po.roi,
                             po.enable_angles, po.angle_path,
-                            po.quality});
+                            po.quality, po.batch_size, po.skip_invisible});
         }
 
         return q;
@@ -52,6 +52,8 @@ namespace paris
         std::string angle_path;
         
         std::uint16_t quality;
+        std::uint16_t batch_size;
+        bool skip_invisible;
     };
 
     auto make_tasks(const program_options& po, const volume_geometry& vol_geo, const subvolume_info& subvol_info)
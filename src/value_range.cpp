@@ -0,0 +1,100 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "value_range.h"
+
+namespace paris
+{
+    namespace
+    {
+        constexpr auto histogram_bins = std::size_t{65536};
+    }
+
+    auto measure(const float* data, std::size_t n, float window_min, float window_max) noexcept -> value_range
+    {
+        auto r = value_range{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), n, 0u};
+        for(auto i = std::size_t{0}; i < n; ++i)
+        {
+            const auto v = data[i];
+            r.min = std::min(r.min, v);
+            r.max = std::max(r.max, v);
+            r.clipped += !(v >= window_min && v <= window_max);
+        }
+        return r;
+    }
+
+    auto merge(const value_range& a, const value_range& b) noexcept -> value_range
+    {
+        return value_range{std::min(a.min, b.min), std::max(a.max, b.max), a.count + b.count, a.clipped + b.clipped};
+    }
+
+    auto estimate_window(const float* data, std::size_t n, double lower, double upper, double margin)
+        -> std::pair<float, float>
+    {
+        const auto r = measure(data, n, 0.f, 0.f);
+        if(n == 0u || !(r.max > r.min))
+            return std::make_pair(r.min, r.min + 1.f);
+
+        // one bin per uint16 value -> the percentiles are as precise as the output
+        const auto width = static_cast<double>(r.max) - static_cast<double>(r.min);
+        const auto scale = static_cast<double>(histogram_bins - 1u) / width;
+        auto histogram = std::vector<std::size_t>(histogram_bins);
+        auto valid = std::size_t{0};
+        for(auto i = std::size_t{0}; i < n; ++i)
+        {
+            if(std::isnan(data[i]))
+                continue;
+
+            const auto b = static_cast<std::size_t>((static_cast<double>(data[i]) - r.min) * scale);
+            ++histogram[std::min(b, histogram_bins - 1u)];
+            ++valid;
+        }
+
+        auto percentile = [&](double p)
+        {
+            const auto target = static_cast<std::size_t>(p * static_cast<double>(valid));
+            auto sum = std::size_t{0};
+            for(auto b = std::size_t{0}; b < histogram_bins; ++b)
+            {
+                sum += histogram[b];
+                if(sum > target)
+                    return static_cast<double>(r.min) + static_cast<double>(b) / scale;
+            }
+            return static_cast<double>(r.max);
+        };
+
+        auto lo = percentile(lower);
+        auto hi = percentile(upper);
+        if(!(hi > lo))
+            hi = lo + 1.0 / scale;
+
+        const auto pad = (hi - lo) * margin;
+        return std::make_pair(static_cast<float>(lo - pad), static_cast<float>(hi + pad));
+    }
+}
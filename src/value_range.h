@@ -0,0 +1,51 @@
+/*
+ * This file is part of the PARIS reconstruction program.
+ *
+ * Copyright (C) 2016 Helmholtz-Zentrum Dresden-Rossendorf
+ *
+ * PARIS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PARIS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PARIS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Date: 15 October 2026
+ * Authors: Jan Stephan <j.stephan@hzdr.de>
+ */
+
+#ifndef PARIS_VALUE_RANGE_H_
+#define PARIS_VALUE_RANGE_H_
+
+#include <cstddef>
+#include <utility>
+
+namespace paris
+{
+    struct value_range
+    {
+        float min;
+        float max;
+        std::size_t count;
+        std::size_t clipped;    // values outside the window, including NaN
+    };
+
+    // a single pass over the data, ranges of several subvolumes are merged with merge()
+    auto measure(const float* data, std::size_t n, float window_min, float window_max) noexcept -> value_range;
+    auto merge(const value_range& a, const value_range& b) noexcept -> value_range;
+
+    /**
+     * Estimates a window from the lower and upper percentile (given as fractions) of a histogram over the data.
+     * The window is widened by margin times its width on both sides so the tails are not clipped.
+     */
+    auto estimate_window(const float* data, std::size_t n, double lower, double upper, double margin)
+        -> std::pair<float, float>;
+}
+
+#endif /* PARIS_VALUE_RANGE_H_ */
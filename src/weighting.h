@@ -23,15 +23,18 @@
 #ifndef PARIS_WEIGHTING_H_
 #define PARIS_WEIGHTING_H_
 
+#include <string>
+
 #include "backend.h"
 #include "geometry.h"
-#include "projection.h"
 
 namespace paris
 {
-    auto weight(backend::projection_device_type& p, const detector_geometry& det_geo)
-        noexcept(true && noexcept(backend::weight))
-        -> void; 
+    /**
+     * Precomputes the cosine weights for every detector pixel. The map is applied while the projection is padded
+     * for filtering, see filter(). If cache_dir is not empty, the map is loaded from or stored in it.
+     */
+    auto make_weights(const detector_geometry& det_geo, const std::string& cache_dir) -> backend::weight_buffer_type;
 }
 
 #endif /* PARIS_WEIGHTING_H_ */